@@ -53,6 +53,8 @@ namespace UnrealBuildTool.Rules
                     "JsonUtilities",
                     "WebSockets",
                     "HTTP",
+                    "Sockets",
+                    "Networking",
                     // ... add other public dependencies that you statically link with here ...
                 }
                 );
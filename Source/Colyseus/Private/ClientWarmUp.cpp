@@ -0,0 +1,89 @@
+#include "ClientWarmUp.h"
+
+#include "WebSocketTransport.h"
+
+#include <Async/Async.h>
+#include <GenericPlatform/GenericPlatformHttp.h>
+#include <HAL/PlatformTime.h>
+#include <HttpModule.h>
+#include <Interfaces/IHttpRequest.h>
+#include <Interfaces/IHttpResponse.h>
+#include <SocketSubsystem.h>
+
+namespace
+{
+// The DNS and HTTP steps finish on their own; whichever is last reports the timings.
+struct WarmUpState
+{
+	WarmUpTimings Timings;
+	double StartTime = 0.0;
+	int32 PendingSteps = 2;
+	TFunction<void(const WarmUpTimings&)> OnComplete;
+
+	void CompleteStep()
+	{
+		check(IsInGameThread());
+		if (--PendingSteps == 0)
+		{
+			Timings.TotalSeconds = FPlatformTime::Seconds() - StartTime;
+			if (OnComplete)
+			{
+				OnComplete(Timings);
+			}
+		}
+	}
+};
+}
+
+void ClientWarmUp::Run(const FString& HttpEndpoint, bool bLoadWebSockets, const TFunction<void(const WarmUpTimings&)>& OnComplete)
+{
+	TSharedRef<WarmUpState> State = MakeShared<WarmUpState>();
+	State->StartTime = FPlatformTime::Seconds();
+	State->OnComplete = OnComplete;
+
+	// Open the connection first so the module load below overlaps with it.
+	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = FHttpModule::Get().CreateRequest();
+	Request->SetURL(HttpEndpoint + TEXT("/"));
+	Request->SetVerb(TEXT("HEAD"));
+	Request->OnProcessRequestComplete().BindLambda(
+		[State](FHttpRequestPtr, FHttpResponsePtr Response, bool bWasSuccessful)
+		{
+			// Any answer, even an error status, means the connection (and TLS session) is up.
+			State->Timings.bPreconnected = bWasSuccessful && Response.IsValid();
+			State->Timings.PreconnectSeconds = FPlatformTime::Seconds() - State->StartTime;
+			State->CompleteStep();
+		});
+	Request->ProcessRequest();
+
+	// Resolving ahead also warms the OS cache for SocketTransport, which does its own lookup.
+	const FString Host = FGenericPlatformHttp::GetUrlDomain(HttpEndpoint);
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	if (SocketSubsystem && !Host.IsEmpty())
+	{
+		SocketSubsystem->GetAddressInfoAsync(
+			[State](FAddressInfoResult Result)
+			{
+				const bool bResolved = Result.ReturnCode == SE_NO_ERROR && Result.Results.Num() > 0;
+				const double Seconds = FPlatformTime::Seconds() - State->StartTime;
+				AsyncTask(ENamedThreads::GameThread,
+					[State, bResolved, Seconds]()
+					{
+						State->Timings.bDnsResolved = bResolved;
+						State->Timings.DnsSeconds = Seconds;
+						State->CompleteStep();
+					});
+			},
+			*Host);
+	}
+	else
+	{
+		State->CompleteStep();
+	}
+
+	if (bLoadWebSockets)
+	{
+		const double ModuleStart = FPlatformTime::Seconds();
+		WebSocketTransport::EnsureModuleLoaded();
+		State->Timings.ModuleLoadSeconds = FPlatformTime::Seconds() - ModuleStart;
+	}
+}
@@ -0,0 +1,79 @@
+#include "ColyseusLoadGenCommandlet.h"
+
+#include "ColyseusUtils.h"
+#include "LoadGenerator.h"
+
+#include <HAL/PlatformProcess.h>
+#include <Misc/Parse.h>
+
+UColyseusLoadGenCommandlet::UColyseusLoadGenCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UColyseusLoadGenCommandlet::Main(const FString& Params)
+{
+	LoadGeneratorSettings Settings;
+	double Duration = 30.0;
+	double ReportInterval = 5.0;
+
+	FParse::Value(*Params, TEXT("endpoint="), Settings.Endpoint);
+	FParse::Value(*Params, TEXT("room="), Settings.RoomName);
+	FParse::Value(*Params, TEXT("type="), Settings.MessageType);
+	FParse::Value(*Params, TEXT("clients="), Settings.NumClients);
+	FParse::Value(*Params, TEXT("joinspertick="), Settings.JoinsPerTick);
+	FParse::Value(*Params, TEXT("rate="), Settings.MessagesPerSecond);
+	FParse::Value(*Params, TEXT("payload="), Settings.PayloadBytes);
+	FParse::Value(*Params, TEXT("duration="), Duration);
+	FParse::Value(*Params, TEXT("report="), ReportInterval);
+	Settings.bUseSocketTransport = !FParse::Param(*Params, TEXT("websocket"));
+
+	LoadGenerator<void> Generator(Settings);
+	Generator.Start();
+
+	const double StartTime = FPlatformTime::Seconds();
+	double LastTickTime = StartTime;
+	double NextReportTime = StartTime + ReportInterval;
+
+	while (true)
+	{
+		const double Now = FPlatformTime::Seconds();
+		if (Now - StartTime >= Duration)
+		{
+			break;
+		}
+
+		// No engine loop runs in a commandlet, so the HTTP manager and the WebSocket module's ticker are pumped here.
+		TickColyseusCore((float) (Now - LastTickTime));
+		LastTickTime = Now;
+
+		Generator.Tick();
+
+		if (Now >= NextReportTime)
+		{
+			const LoadGeneratorReport Report = Generator.Report();
+			UE_LOG(LogTemp, Display, TEXT("Colyseus load: %d joined, %d failed, %llu sent, %llu received, p50 %llu us, p99 %llu us"),
+				Report.ClientsJoined, Report.ClientsFailed, Report.MessagesSent, Report.MessagesReceived,
+				Report.LatencyMicrosP50, Report.LatencyMicrosP99);
+			NextReportTime = Now + ReportInterval;
+		}
+
+		FPlatformProcess::Sleep(0.001f);
+	}
+
+	const LoadGeneratorReport Report = Generator.Report();
+	UE_LOG(LogTemp, Display, TEXT("Colyseus load generator finished after %.1f s"), Report.Seconds);
+	UE_LOG(LogTemp, Display, TEXT("  clients: %d joined, %d failed, %d left"), Report.ClientsJoined, Report.ClientsFailed, Report.ClientsLeft);
+	UE_LOG(LogTemp, Display, TEXT("  messages: %llu sent, %llu received (%llu bytes out, %llu bytes in)"),
+		Report.MessagesSent, Report.MessagesReceived, Report.BytesOut, Report.BytesIn);
+	UE_LOG(LogTemp, Display, TEXT("  latency: p50 %llu us, p90 %llu us, p99 %llu us, max %llu us"),
+		Report.LatencyMicrosP50, Report.LatencyMicrosP90, Report.LatencyMicrosP99, Report.LatencyMicrosMax);
+	UE_LOG(LogTemp, Display, TEXT("  decode: %.1f us per client per second"), Report.DecodeMicrosPerClientSecond);
+	UE_LOG(LogTemp, Display, TEXT("  memory: %lld bytes per room"), Report.MemoryPerRoomBytes);
+
+	Generator.Stop();
+	return Report.ClientsFailed > 0 ? 1 : 0;
+}
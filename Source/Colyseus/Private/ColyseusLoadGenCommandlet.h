@@ -0,0 +1,25 @@
+#pragma once
+
+#include <CoreMinimal.h>
+#include <Commandlets/Commandlet.h>
+
+#include "ColyseusLoadGenCommandlet.generated.h"
+
+/**
+ * Runs LoadGenerator headless:
+ *
+ *     UE4Editor-Cmd <Project> -run=ColyseusLoadGen -clients=1000 -rate=10 -payload=32 -duration=30
+ *         [-endpoint=ws://localhost:2567] [-room=my_room] [-type=loadgen] [-websocket]
+ *
+ * Without -endpoint every client talks to the in-process echo stand-in.
+ */
+UCLASS()
+class UColyseusLoadGenCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UColyseusLoadGenCommandlet();
+
+	int32 Main(const FString& Params) override;
+};
@@ -1,5 +1,8 @@
 #include "ColyseusUtils.h"
 
+#include <HttpManager.h>
+#include <HttpModule.h>
+
 std::string FStringToStdString(const FString& UEString)
 {
 	return std::string(TCHAR_TO_UTF8(*UEString));
@@ -9,3 +12,38 @@ FString StdStringToFString(const std::string& StdString)
 {
 	return FString(UTF8_TO_TCHAR(StdString.c_str()));
 }
+
+void TickColyseusCore(float DeltaSeconds)
+{
+#if ENGINE_MAJOR_VERSION >= 5
+	FTSTicker::GetCoreTicker().Tick(DeltaSeconds);
+#else
+	FTicker::GetCoreTicker().Tick(DeltaSeconds);
+#endif
+	FHttpModule::Get().GetHttpManager().Tick(DeltaSeconds);
+}
+
+ColyseusTimerHandle SetColyseusTimeout(float DelaySeconds, const TFunction<void()>& Callback)
+{
+	// Returning false from the ticker delegate removes it, so it fires once.
+	auto Fire = [Callback](float) -> bool
+	{
+		Callback();
+		return false;
+	};
+
+#if ENGINE_MAJOR_VERSION >= 5
+	return FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(Fire), DelaySeconds);
+#else
+	return FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(Fire), DelaySeconds);
+#endif
+}
+
+void ClearColyseusTimeout(const ColyseusTimerHandle& Handle)
+{
+#if ENGINE_MAJOR_VERSION >= 5
+	FTSTicker::GetCoreTicker().RemoveTicker(Handle);
+#else
+	FTicker::GetCoreTicker().RemoveTicker(Handle);
+#endif
+}
@@ -1,20 +1,107 @@
 #include "Compare.h"
 
-msgpack::object_handle* Compare::emptyState = nullptr;
+#include <Async/ParallelFor.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+size_t Compare::maxArrayDiffCells = 1 << 18;
 
 void msgdebug(msgpack::object obj)
 {
 	std::cout << obj << std::endl;
 }
 
-PatchObject::PatchObject(std::vector<std::string> path, std::string op, msgpack::object value)
+const PathNode* PathArena::push(const PathNode* parent, const msgpack::object& key)
+{
+	nodes.push_back(PathNode{parent, key.via.str.ptr, key.via.str.size});
+	return &nodes.back();
+}
+
+const PathNode* PathArena::push(const PathNode* parent, uint32_t index)
+{
+	nodes.push_back(PathNode{parent, nullptr, index});
+	return &nodes.back();
+}
+
+size_t PathArena::size() const
+{
+	return nodes.size();
+}
+
+void PathArena::rewind(size_t count)
+{
+	while (nodes.size() > count)
+	{
+		nodes.pop_back();
+	}
+}
+
+PatchObject::PatchObject(std::shared_ptr<const PathArena> arena, const PathNode* path, std::string op, msgpack::object value,
+	const PathNode* fromPath)
+	: arena(std::move(arena)), path(path), fromPath(fromPath)
 {
-	this->path = path;
 	this->op = op;
 	this->value = value;
 	//    this->previousValue = previousValue;
 }
 
+static std::vector<std::string> materializePath(const PathNode* path)
+{
+	size_t depth = 0;
+	for (const PathNode* node = path; node; node = node->parent)
+	{
+		depth++;
+	}
+
+	std::vector<std::string> result(depth);
+	for (const PathNode* node = path; node; node = node->parent)
+	{
+		if (node->data)
+		{
+			result[--depth].assign(node->data, node->size);
+		}
+		else
+		{
+			result[--depth] = std::to_string(node->size);
+		}
+	}
+	return result;
+}
+
+std::vector<std::string> PatchObject::getPath() const
+{
+	return materializePath(path);
+}
+
+std::vector<std::string> PatchObject::getFromPath() const
+{
+	return materializePath(fromPath);
+}
+
+bool Compare::KeyView::operator==(const KeyView& other) const
+{
+	return size == other.size && memcmp(data, other.data, size) == 0;
+}
+
+size_t Compare::KeyViewHash::operator()(const KeyView& key) const
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+	for (uint32_t i = 0; i < key.size; i++)
+	{
+		hash ^= (unsigned char) key.data[i];
+		hash *= 1099511628211ULL;
+	}
+	return (size_t) hash;
+}
+
+static Compare::KeyView toKeyView(const msgpack::object& key)
+{
+	return Compare::KeyView{key.via.str.ptr, key.via.str.size};
+}
+
 bool Compare::containsKey(msgpack::object_map map, msgpack::object_kv key)
 {
 #ifdef COLYSEUS_DEBUG
@@ -25,39 +112,272 @@ bool Compare::containsKey(msgpack::object_map map, msgpack::object_kv key)
 	std::cout << "========================================================" << std::endl;
 #endif
 
+	if (key.key.type != msgpack::type::STR)
+	{
+		return false;
+	}
+
+	const KeyView key2 = toKeyView(key.key);
 	for (uint32_t i = 0; i < map.size; i++)
 	{
+		if (map.ptr[i].key.type == msgpack::type::STR && toKeyView(map.ptr[i].key) == key2)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void Compare::buildKeyIndex(const msgpack::object_map& map, KeyIndex& index)
+{
+	index.clear();
+	index.reserve(map.size);
+	for (uint32_t i = 0; i < map.size; i++)
+	{
+		// Colyseus states only use string keys; any other key never matches, as in containsKey().
 		if (map.ptr[i].key.type == msgpack::type::STR)
 		{
-			std::string key1;
-			map.ptr[i].key.convert(key1);
+			index.emplace(toKeyView(map.ptr[i].key), i);
+		}
+	}
+}
+
+static const void* containerKey(const msgpack::object& value)
+{
+	if (value.type == msgpack::type::MAP && value.via.map.size > 0)
+	{
+		return value.via.map.ptr;
+	}
+	if (value.type == msgpack::type::ARRAY && value.via.array.size > 0)
+	{
+		return value.via.array.ptr;
+	}
+	return nullptr;
+}
 
-			if (key.key.type == msgpack::type::STR)
+static uint64_t mixHash(uint64_t hash, uint64_t value)
+{
+	return hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+}
+
+bool SubtreeFingerprints::same(const msgpack::object& oldValue, const msgpack::object& newValue)
+{
+	if (!containerKey(oldValue) || !containerKey(newValue))
+	{
+		return oldValue == newValue;
+	}
+	size_t objects = 0;
+	return hash(oldValue, previous, !frozen, objects) == hash(newValue, current, !frozen, objects);
+}
+
+void SubtreeFingerprints::clear()
+{
+	previous.clear();
+	current.clear();
+	advanced = false;
+	frozen = false;
+}
+
+void SubtreeFingerprints::advance()
+{
+	advanced = true;
+}
+
+void SubtreeFingerprints::begin()
+{
+	if (advanced)
+	{
+		previous.swap(current);
+	}
+	else
+	{
+		previous.clear();
+	}
+	current.clear();
+	current.reserve(previous.size());
+	advanced = false;
+}
+
+uint64_t SubtreeFingerprints::hash(const msgpack::object& value, HashTable& table, bool cache, size_t& objects)
+{
+	const void* key = containerKey(value);
+	if (key)
+	{
+		auto found = table.find(key);
+		if (found != table.end())
+		{
+			return found->second;
+		}
+	}
+
+	size_t children = 0;
+	uint64_t result = value.type;
+	switch (value.type)
+	{
+		case msgpack::type::BOOLEAN:
+			result = mixHash(result, value.via.boolean);
+			break;
+		case msgpack::type::POSITIVE_INTEGER:
+		case msgpack::type::NEGATIVE_INTEGER:
+			result = mixHash(result, value.via.u64);
+			break;
+		case msgpack::type::FLOAT32:
+		case msgpack::type::FLOAT64:
+		{
+			uint64_t bits;
+			memcpy(&bits, &value.via.f64, sizeof(bits));
+			result = mixHash(result, bits);
+			break;
+		}
+		case msgpack::type::STR:
+			result = mixHash(result, Compare::KeyViewHash()(Compare::KeyView{value.via.str.ptr, value.via.str.size}));
+			break;
+		case msgpack::type::BIN:
+			result = mixHash(result, Compare::KeyViewHash()(Compare::KeyView{value.via.bin.ptr, value.via.bin.size}));
+			break;
+		case msgpack::type::EXT:
+			result = mixHash(result, (uint64_t) value.via.ext.type());
+			result = mixHash(result, Compare::KeyViewHash()(Compare::KeyView{value.via.ext.data(), value.via.ext.size}));
+			break;
+		case msgpack::type::ARRAY:
+			for (uint32_t i = 0; i < value.via.array.size; i++)
 			{
-				std::string key2;
-				key.key.convert(key2);
-				if (key1 == key2)
-				{
-					return true;
-				}
+				result = mixHash(result, hash(value.via.array.ptr[i], table, cache, children));
+			}
+			break;
+		case msgpack::type::MAP:
+			for (uint32_t i = 0; i < value.via.map.size; i++)
+			{
+				result = mixHash(result, hash(value.via.map.ptr[i].key, table, cache, children));
+				result = mixHash(result, hash(value.via.map.ptr[i].val, table, cache, children));
 			}
+			break;
+		default:
+			break;
+	}
+
+	// Small subtrees are cheaper to hash again than to look up.
+	if (cache && key && children >= MinCachedObjects)
+	{
+		table.emplace(key, result);
+	}
+	objects += children + 1;
+	return result;
+}
+
+std::vector<PatchObject> Compare::getPatchList(const msgpack::object tree1, const msgpack::object tree2, SubtreeFingerprints* fingerprints)
+{
+	std::vector<PatchObject> patches;
+	std::shared_ptr<PathArena> arena = std::make_shared<PathArena>();
+
+	if (fingerprints)
+	{
+		fingerprints->begin();
+		if (fingerprints->same(tree1, tree2))
+		{
+			return patches;
 		}
 	}
-	return false;
+
+	generate(tree1, tree2, &patches, arena, nullptr, fingerprints);
+	return patches;
 }
 
-std::vector<PatchObject> Compare::getPatchList(const msgpack::object tree1, const msgpack::object tree2)
+std::vector<PatchObject> Compare::getPatchListParallel(
+	const msgpack::object tree1, const msgpack::object tree2, SubtreeFingerprints* fingerprints, uint32_t keysPerTask)
 {
+	keysPerTask = std::max<uint32_t>(keysPerTask, 1);
+	if (tree1.type != msgpack::type::MAP || tree2.type != msgpack::type::MAP || tree1.via.map.size <= keysPerTask)
+	{
+		return getPatchList(tree1, tree2, fingerprints);
+	}
+
 	std::vector<PatchObject> patches;
-	std::vector<std::string> path;
+	if (fingerprints)
+	{
+		// Hashing both roots caches every subtree the workers will ask about, so they only read the tables.
+		fingerprints->begin();
+		if (fingerprints->same(tree1, tree2))
+		{
+			return patches;
+		}
+		fingerprints->frozen = true;
+	}
+
+	const msgpack::object_map& mirror = tree1.via.map;
+	const msgpack::object_map& obj = tree2.via.map;
+
+	KeyIndex newKeys;
+	buildKeyIndex(obj, newKeys);
+
+	// Each task takes a run of old keys, in the order generate() visits them, into its own patch list and arena.
+	struct Task
+	{
+		std::vector<PatchObject> patches;
+		bool deleted = false;
+	};
+	const uint32_t numTasks = (mirror.size + keysPerTask - 1) / keysPerTask;
+	std::vector<Task> tasks(numTasks);
+
+	ParallelFor((int32) numTasks, [&](int32 taskIndex) {
+		Task& task = tasks[taskIndex];
+		std::shared_ptr<PathArena> arena = std::make_shared<PathArena>();
+		const uint32_t first = taskIndex * keysPerTask;
+		const uint32_t last = std::min(first + keysPerTask, mirror.size);
+		for (uint32_t k = first; k < last; k++)
+		{
+			task.deleted |= generateEntry(mirror.ptr[mirror.size - 1 - k], obj, newKeys, &task.patches, arena, nullptr, fingerprints);
+		}
+	});
+
+	if (fingerprints)
+	{
+		fingerprints->frozen = false;
+	}
+
+	size_t total = 0;
+	bool deleted = false;
+	for (const Task& task : tasks)
+	{
+		total += task.patches.size();
+		deleted |= task.deleted;
+	}
+	patches.reserve(total);
+	for (Task& task : tasks)
+	{
+		std::move(task.patches.begin(), task.patches.end(), std::back_inserter(patches));
+	}
 
-	generate(tree1, tree2, &patches, path);
+	if (deleted || obj.size != mirror.size)
+	{
+		generateAdditions(mirror, obj, &patches, std::make_shared<PathArena>(), nullptr);
+	}
 	return patches;
 }
 
+const msgpack::object& Compare::emptyValue(msgpack::type::object_type type)
+{
+	// Immutable once initialised (which C++11 makes thread-safe), so concurrent diffs can share them.
+	static const msgpack::object emptyMap = [] {
+		msgpack::object value;
+		value.type = msgpack::type::MAP;
+		value.via.map.size = 0;
+		value.via.map.ptr = nullptr;
+		return value;
+	}();
+	static const msgpack::object emptyArray = [] {
+		msgpack::object value;
+		value.type = msgpack::type::ARRAY;
+		value.via.array.size = 0;
+		value.via.array.ptr = nullptr;
+		return value;
+	}();
+	return type == msgpack::type::ARRAY ? emptyArray : emptyMap;
+}
+
 // Dirty check if obj is different from mirror, generate patches and update mirror
 void Compare::generate(const msgpack::object mirrorPacked, const msgpack::object objPacked, std::vector<PatchObject>* patches,
-	std::vector<std::string> path)
+	const std::shared_ptr<PathArena>& arena, const PathNode* path, SubtreeFingerprints* fingerprints)
 {
 #ifdef COLYSEUS_DEBUG
 	std::cout << "----------------------- Compare::generate ------------------------" << std::endl;
@@ -66,78 +386,387 @@ void Compare::generate(const msgpack::object mirrorPacked, const msgpack::object
 	std::cout << "------------------------------------------------------------------" << std::endl;
 #endif
 
-	msgpack::object_map mirror = mirrorPacked.via.map;
-	msgpack::object_map obj = objPacked.via.map;
+	if (mirrorPacked.type == msgpack::type::ARRAY && objPacked.type == msgpack::type::ARRAY)
+	{
+		generateArray(mirrorPacked, objPacked, patches, arena, path, fingerprints);
+		return;
+	}
+
+	// Only maps and arrays are compared part by part; callers compare other values as a whole.
+	if (mirrorPacked.type != msgpack::type::MAP || objPacked.type != msgpack::type::MAP)
+	{
+		return;
+	}
+
+	const msgpack::object_map& mirror = mirrorPacked.via.map;
+	const msgpack::object_map& obj = objPacked.via.map;
+
+	KeyIndex newKeys;
+	buildKeyIndex(obj, newKeys);
 
-	auto newKeys = obj.ptr;
-	auto oldKeys = mirror.ptr;
 	bool deleted = false;
 	for (int i = mirror.size - 1; i >= 0; i--)
 	{
-		msgpack::object_kv kv = oldKeys[i];
+		deleted |= generateEntry(mirror.ptr[i], obj, newKeys, patches, arena, path, fingerprints);
+	}
 
-		if (containsKey(obj, kv) && containsKey(mirror, kv) && objPacked.type != msgpack::type::ARRAY)
+	if (!deleted && obj.size == mirror.size)
+	{
+		return;
+	}
+
+	generateAdditions(mirror, obj, patches, arena, path);
+}
+
+bool Compare::generateEntry(const msgpack::object_kv& kv, const msgpack::object_map& obj, const KeyIndex& newKeys,
+	std::vector<PatchObject>* patches, const std::shared_ptr<PathArena>& arena, const PathNode* path,
+	SubtreeFingerprints* fingerprints)
+{
+	auto found = kv.key.type == msgpack::type::STR ? newKeys.find(toKeyView(kv.key)) : newKeys.end();
+	if (found != newKeys.end())
+	{
+		const msgpack::object& oldVal = kv.val;
+		const msgpack::object& newVal = obj.ptr[found->second].val;
+
+		if (fingerprints && fingerprints->same(oldVal, newVal))
 		{
-			auto oldVal = mirror.ptr[i].val;
-			auto newVal = obj.ptr[i].val;
+			return false;
+		}
 
-			if (oldVal.type == msgpack::type::MAP && newVal.type == msgpack::type::MAP)
+		// Most values are unchanged; drop their path node again if nothing below it changed.
+		const size_t arenaSize = arena->size();
+		const size_t patchCount = patches->size();
+		generateValue(oldVal, newVal, patches, arena, arena->push(path, kv.key), fingerprints);
+		if (patches->size() == patchCount)
+		{
+			arena->rewind(arenaSize);
+		}
+		return false;
+	}
+
+	if (kv.key.type == msgpack::type::STR)
+	{
+		msgpack::object val;
+		patches->push_back(PatchObject(arena, arena->push(path, kv.key), "remove", val));
+		return true;	// property has been deleted
+	}
+	return false;
+}
+
+void Compare::generateAdditions(const msgpack::object_map& mirror, const msgpack::object_map& obj,
+	std::vector<PatchObject>* patches, const std::shared_ptr<PathArena>& arena, const PathNode* path)
+{
+	KeyIndex oldKeys;
+	buildKeyIndex(mirror, oldKeys);
+
+	for (int i = obj.size - 1; i >= 0; i--)
+	{
+		const msgpack::object_kv& kv = obj.ptr[i];
+		if (kv.key.type == msgpack::type::STR && oldKeys.find(toKeyView(kv.key)) == oldKeys.end())
+		{
+			const PathNode* addPath = arena->push(path, kv.key);
+
+			const msgpack::object& newVal = kv.val;
+
+			// compare deeper additions
+			if (newVal.type == msgpack::type::MAP || newVal.type == msgpack::type::ARRAY)
 			{
-				std::vector<std::string> deeperPath(path);
-				std::string aa;
-				kv.key.convert(aa);
-				deeperPath.push_back(aa);
-				generate(oldVal, newVal, patches, deeperPath);
+				generate(emptyValue(newVal.type), newVal, patches, arena, addPath);
+			}
+
+			patches->push_back(PatchObject(arena, addPath, "add", newVal));
+		}
+	}
+}
+
+void Compare::generateValue(const msgpack::object& oldVal, const msgpack::object& newVal, std::vector<PatchObject>* patches,
+	const std::shared_ptr<PathArena>& arena, const PathNode* path, SubtreeFingerprints* fingerprints)
+{
+	if ((oldVal.type == msgpack::type::MAP && newVal.type == msgpack::type::MAP) ||
+		(oldVal.type == msgpack::type::ARRAY && newVal.type == msgpack::type::ARRAY))
+	{
+		generate(oldVal, newVal, patches, arena, path, fingerprints);
+	}
+	else if (oldVal != newVal)
+	{
+		patches->push_back(PatchObject(arena, path, "replace", newVal));
+	}
+}
+
+void Compare::generateArray(const msgpack::object& mirrorPacked, const msgpack::object& objPacked,
+	std::vector<PatchObject>* patches, const std::shared_ptr<PathArena>& arena, const PathNode* path,
+	SubtreeFingerprints* fingerprints)
+{
+	const msgpack::object_array& mirror = mirrorPacked.via.array;
+	const msgpack::object_array& obj = objPacked.via.array;
+
+	auto equal = [fingerprints](const msgpack::object& a, const msgpack::object& b) {
+		return fingerprints ? fingerprints->same(a, b) : a == b;
+	};
+
+	// Only the middle section between the common prefix and suffix is aligned.
+	uint32_t prefix = 0;
+	while (prefix < mirror.size && prefix < obj.size && equal(mirror.ptr[prefix], obj.ptr[prefix]))
+	{
+		prefix++;
+	}
+	uint32_t suffix = 0;
+	while (suffix < mirror.size - prefix && suffix < obj.size - prefix &&
+		   equal(mirror.ptr[mirror.size - 1 - suffix], obj.ptr[obj.size - 1 - suffix]))
+	{
+		suffix++;
+	}
+
+	const uint32_t n = mirror.size - prefix - suffix;
+	const uint32_t m = obj.size - prefix - suffix;
+	if (n == 0 && m == 0)
+	{
+		return;
+	}
+	const msgpack::object* oldItems = mirror.ptr + prefix;
+	const msgpack::object* newItems = obj.ptr + prefix;
+
+	enum class Fate : uint8_t
+	{
+		Inserted,
+		Kept,
+		Changed,
+		Moved,
+	};
+
+	// Old element each new one comes from (-1 when inserted), and the new element each old one went to.
+	std::vector<int32_t> source(m, -1);
+	std::vector<Fate> fates(m, Fate::Inserted);
+	std::vector<int32_t> target(n, -1);
+
+	auto link = [&](uint32_t i, uint32_t j, Fate fate) {
+		source[j] = (int32_t) i;
+		target[i] = (int32_t) j;
+		fates[j] = fate;
+	};
+
+	if ((uint64_t) n * m > maxArrayDiffCells)
+	{
+		for (uint32_t k = 0; k < n && k < m; k++)
+		{
+			link(k, k, Fate::Changed);
+		}
+	}
+	else
+	{
+		// Elements are matched by hash; the hash tables of fingerprints are reused when set.
+		SubtreeFingerprints::HashTable scratch;
+		const bool cache = !fingerprints || !fingerprints->frozen;
+		std::vector<uint64_t> oldHashes(n);
+		std::vector<uint64_t> newHashes(m);
+		size_t objects = 0;
+		for (uint32_t i = 0; i < n; i++)
+		{
+			oldHashes[i] = SubtreeFingerprints::hash(oldItems[i], fingerprints ? fingerprints->previous : scratch, cache, objects);
+		}
+		for (uint32_t j = 0; j < m; j++)
+		{
+			newHashes[j] = SubtreeFingerprints::hash(newItems[j], fingerprints ? fingerprints->current : scratch, cache, objects);
+		}
+
+		// lcs[i * (m + 1) + j]: length of the longest common subsequence of oldItems[i..] and newItems[j..]
+		std::vector<uint32_t> lcs((size_t) (n + 1) * (m + 1), 0);
+		for (int64_t i = (int64_t) n - 1; i >= 0; i--)
+		{
+			for (int64_t j = (int64_t) m - 1; j >= 0; j--)
+			{
+				const size_t cell = (size_t) i * (m + 1) + j;
+				lcs[cell] = oldHashes[i] == newHashes[j] ? lcs[cell + m + 2] + 1 : std::max(lcs[cell + m + 1], lcs[cell + 1]);
+			}
+		}
+
+		uint32_t i = 0;
+		uint32_t j = 0;
+		while (i < n && j < m)
+		{
+			const size_t cell = (size_t) i * (m + 1) + j;
+			if (oldHashes[i] == newHashes[j])
+			{
+				// Without fingerprints the caller did not accept hash matches, so confirm them.
+				link(i, j, fingerprints || oldItems[i] == newItems[j] ? Fate::Kept : Fate::Changed);
+				i++;
+				j++;
+			}
+			else if (lcs[cell + m + 1] >= lcs[cell + 1])
+			{
+				i++;
 			}
 			else
 			{
-				if (oldVal != newVal)
+				j++;
+			}
+		}
+
+		// An inserted element equal to a removed one is a move.
+		std::unordered_multimap<uint64_t, uint32_t> removed;
+		for (uint32_t k = 0; k < n; k++)
+		{
+			if (target[k] < 0)
+			{
+				removed.emplace(oldHashes[k], k);
+			}
+		}
+		for (uint32_t k = 0; k < m && !removed.empty(); k++)
+		{
+			if (fates[k] != Fate::Inserted)
+			{
+				continue;
+			}
+			auto range = removed.equal_range(newHashes[k]);
+			for (auto it = range.first; it != range.second; ++it)
+			{
+				if (fingerprints || oldItems[it->second] == newItems[k])
 				{
-					std::vector<std::string> replacePath(path);
-					std::string aa;
-					kv.key.convert(aa);
-					replacePath.push_back(aa);
-					patches->push_back(PatchObject(replacePath, "replace", newVal));
+					link(it->second, k, Fate::Moved);
+					removed.erase(it);
+					break;
 				}
 			}
 		}
 
-		else
+		// Between two kept elements, pair what was removed with what was inserted as changes in place.
+		uint32_t oldGap = 0;
+		uint32_t newGap = 0;
+		for (uint32_t k = 0; k <= m; k++)
+		{
+			if (k < m && fates[k] != Fate::Kept)
+			{
+				continue;
+			}
+
+			const uint32_t oldEnd = k < m ? (uint32_t) source[k] : n;
+			uint32_t oldNext = oldGap;
+			for (uint32_t newNext = newGap; newNext < k; newNext++)
+			{
+				if (fates[newNext] != Fate::Inserted)
+				{
+					continue;
+				}
+				while (oldNext < oldEnd && target[oldNext] >= 0)
+				{
+					oldNext++;
+				}
+				if (oldNext == oldEnd)
+				{
+					break;
+				}
+				link(oldNext, newNext, Fate::Changed);
+			}
+
+			oldGap = oldEnd + 1;
+			newGap = k + 1;
+		}
+	}
+
+	// Removals go first, from the back so each index is still the old one.
+	for (int64_t i = (int64_t) n - 1; i >= 0; i--)
+	{
+		if (target[i] < 0)
 		{
-			std::vector<std::string> removePath(path);
-			std::string aa;
-			kv.key.convert(aa);
-			removePath.push_back(aa);
 			msgpack::object val;
-			patches->push_back(PatchObject(removePath, "remove", val));
-			deleted = true;	   // property has been deleted
+			patches->push_back(PatchObject(arena, arena->push(path, prefix + (uint32_t) i), "remove", val));
 		}
 	}
 
-	if (!deleted && obj.size == mirror.size)
+	// Then insertions and moves in new order, each placed right after its predecessor. Kept and changed
+	// elements never move and keep the same order in both arrays, so every element has a fixed slot in
+	// the array being patched: between two of them come the new elements placed so far, then the old
+	// ones still waiting to move. A Fenwick tree counts the occupied slots before each one.
+	std::vector<uint32_t> newSlot(m);
+	std::vector<uint32_t> oldSlot(n);
+	uint32_t slots = 0;
+	uint32_t oldNext = 0;
+	for (uint32_t j = 0; j <= m; j++)
 	{
-		return;
+		if (j < m && (fates[j] == Fate::Inserted || fates[j] == Fate::Moved))
+		{
+			newSlot[j] = slots++;
+			continue;
+		}
+
+		const uint32_t oldEnd = j < m ? (uint32_t) source[j] : n;
+		for (; oldNext < oldEnd; oldNext++)
+		{
+			if (target[oldNext] >= 0)
+			{
+				oldSlot[oldNext] = slots++;
+			}
+		}
+		if (j < m)
+		{
+			oldSlot[oldEnd] = newSlot[j] = slots++;
+			oldNext = oldEnd + 1;
+		}
 	}
 
-	for (int i = obj.size - 1; i >= 0; i--)
+	std::vector<uint32_t> occupied(slots + 1, 0);
+	auto occupy = [&](uint32_t slot, int32_t delta) {
+		for (uint32_t k = slot + 1; k <= slots; k += k & (0 - k))
+		{
+			occupied[k] += delta;
+		}
+	};
+	auto positionOf = [&](uint32_t slot) {
+		uint32_t count = 0;
+		for (uint32_t k = slot; k > 0; k -= k & (0 - k))
+		{
+			count += occupied[k];
+		}
+		return count;
+	};
+	for (uint32_t i = 0; i < n; i++)
+	{
+		if (target[i] >= 0)
+		{
+			occupy(oldSlot[i], 1);
+		}
+	}
+
+	for (uint32_t j = 0; j < m; j++)
 	{
-		msgpack::object_kv kv = newKeys[i];
-		if (!containsKey(mirror, kv) && containsKey(obj, kv))
+		if (fates[j] != Fate::Inserted && fates[j] != Fate::Moved)
 		{
-			std::vector<std::string> addPath(path);
-			std::string aa;
-			kv.key.convert(aa);
-			addPath.push_back(aa);
+			continue;
+		}
 
-			auto newVal = obj.ptr[i].val;
+		uint32_t from = 0;
+		if (fates[j] == Fate::Moved)
+		{
+			from = positionOf(oldSlot[source[j]]);
+			occupy(oldSlot[source[j]], -1);
+		}
 
-			// compare deeper additions
-			if ((newVal.type == msgpack::type::MAP || newVal.type == msgpack::type::ARRAY) && newVal.type != msgpack::type::NIL)
+		const uint32_t to = positionOf(newSlot[j]);
+		occupy(newSlot[j], 1);
+
+		if (fates[j] == Fate::Inserted)
+		{
+			patches->push_back(PatchObject(arena, arena->push(path, prefix + to), "add", newItems[j]));
+		}
+		else if (from != to)
+		{
+			patches->push_back(PatchObject(
+				arena, arena->push(path, prefix + to), "move", newItems[j], arena->push(path, prefix + from)));
+		}
+	}
+
+	// The array now has the new order, so changed elements are diffed at their new index.
+	for (uint32_t j = 0; j < m; j++)
+	{
+		if (fates[j] == Fate::Changed && !equal(oldItems[source[j]], newItems[j]))
+		{
+			const size_t arenaSize = arena->size();
+			const size_t patchCount = patches->size();
+			generateValue(oldItems[source[j]], newItems[j], patches, arena, arena->push(path, prefix + j), fingerprints);
+			if (patches->size() == patchCount)
 			{
-				generate(emptyState->get(), newVal, patches, addPath);
+				arena->rewind(arenaSize);
 			}
-
-			patches->push_back(PatchObject(addPath, "add", newVal));
 		}
 	}
 }
@@ -1,78 +1,262 @@
 #include "Connection.h"
 
-#include <WebSocketsModule.h>
+#include "WebSocketTransport.h"
+
+Connection::~Connection()
+{
+	if (Transport)
+	{
+		Transport->Detach();
+		Transport = nullptr;
+	}
+}
 
 void Connection::Connect(const FString& Url)
 {
-	if (!FModuleManager::Get().IsModuleLoaded("WebSockets"))
+	Transport = CreateTransport ? CreateTransport() : MakeShared<WebSocketTransport>();
+
+	// Transports that call back from their own thread can only be used through the event queue.
+	if (Transport->RequiresEventQueue() && !Queue)
 	{
-		FModuleManager::Get().LoadModule("WebSockets");
+		EnableEventQueue();
 	}
 
-	Socket = FWebSocketsModule::Get().CreateWebSocket(Url, "wss");
+	Transport->OnConnected = [this]() -> void
+	{
+		this->HandleEvent(FrameQueue::EventType::Open);
+	};
+
+	Transport->OnConnectionError = [this](const FString& message) -> void
+	{
+		this->HandleEvent(FrameQueue::EventType::Error, 0, message);
+	};
 
-	Socket->OnConnected().AddLambda(
-		[this]() -> void
+	Transport->OnRawMessage = [this](const void* Data, SIZE_T Size, SIZE_T BytesRemaining) -> void
+	{
+		if (this->OnMessage)
 		{
-			if (this->OnOpen)
+			// If there are bytes remaining in the message, we need to buffer the received data
+			// and wait until we receive a message with no bytes remaining.
+			// This is to prevent MsgPack from trying to deserialize partial messages.
+			if (BytesRemaining > 0)
 			{
-				this->OnOpen();
+				// The first fragment tells us how large the frame will be, so size the buffer once.
+				if (this->ReceiveBuffer.Num() == 0)
+				{
+					this->ReceiveBuffer = this->BufferPool.Acquire(Size + BytesRemaining);
+				}
+
+				this->ReceiveBuffer.Append(static_cast<const uint8*>(Data), Size);
+				return;
 			}
-		});
 
-	Socket->OnConnectionError().AddLambda(
-		[this](const FString& message) -> void
-		{
-			if (this->OnError)
+			// Otherwise, this message was either received as a complete message, or in buffered chunks.
+			// If a complete message (else case), we can avoid the overhead of buffering.
+			if (this->ReceiveBuffer.Num() > 0)
+			{
+				this->ReceiveBuffer.Append(static_cast<const uint8*>(Data), Size);
+				this->HandleFrame(this->ReceiveBuffer.GetData(), this->ReceiveBuffer.Num(), &this->ReceiveBuffer);
+			}
+			else
 			{
-				this->OnError(message);
+				this->HandleFrame(Data, Size, nullptr);
 			}
-		});
+		}
+	};
+
+	Transport->OnClosed = [this](int32 StatusCode, const FString& Reason, bool bWasClean) -> void
+	{
+		this->HandleEvent(FrameQueue::EventType::Close, StatusCode, Reason, bWasClean);
+	};
 
-	Socket->OnRawMessage().AddLambda(
-		[this](const void* Data, SIZE_T Size, SIZE_T BytesRemaining) -> void
+	Transport->Connect(Url);
+}
+
+void Connection::Send(const void* Buffer, SIZE_T Size, uint32 CoalesceKey, bool bCanDrop)
+{
+	if (!OutboundQueue)
+	{
+		if (Transport)
 		{
-			if (this->OnMessage)
-			{
-				// If there are bytes remaining in the message, we need to buffer the received data
-				// and wait until we receive a message with no bytes remaining.
-				// This is to prevent MsgPack from trying to deserialize partial messages.
-				if (BytesRemaining > 0)
-				{
-					this->ReceiveBuffer.Append(static_cast<const uint8*>(Data), Size);
-					return;
-				}
+			Transport->Send(Buffer, Size);
+		}
+		return;
+	}
 
-				// Otherwise, this message was either received as a complete message, or in buffered chunks.
-				// If a complete message (else case), we can avoid the overhead of buffering.
-				if (this->ReceiveBuffer.Num() > 0)
-				{
-					this->ReceiveBuffer.Append(static_cast<const uint8*>(Data), Size);
-					this->OnMessage(static_cast<const void*>(this->ReceiveBuffer.GetData()), this->ReceiveBuffer.Num(), 0);
-					this->ReceiveBuffer.Empty();
-				}
-				else
-				{
-					this->OnMessage(Data, Size, 0);
-				}
-			}
-		});
+	OutboundQueue->Enqueue(Buffer, Size, CoalesceKey, bCanDrop);
+	FlushSendQueue();
+}
+
+void Connection::SendImmediate(const void* Buffer, SIZE_T Size)
+{
+	if (Transport)
+	{
+		Transport->Send(Buffer, Size);
+	}
+}
+
+double Connection::GetDispatchQueueSeconds() const
+{
+	return DispatchingEnqueuedCycles ? FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - DispatchingEnqueuedCycles) : 0.0;
+}
+
+void Connection::EnableSendQueue(const SendQueueSettings& Settings)
+{
+	OutboundQueue = MakeUnique<SendQueue>(Settings);
+}
+
+int32 Connection::FlushSendQueue()
+{
+	if (!OutboundQueue || !Transport)
+	{
+		return 0;
+	}
 
-	Socket->OnClosed().AddLambda(
-		[this](int32 StatusCode, const FString& Reason, bool bWasClean) -> void
+	// Hold frames back while the transport itself still has a backlog, so they can still be coalesced or dropped.
+	int64 MaxBytes = MAX_int64;
+	const SendQueueSettings& Settings = OutboundQueue->Settings;
+	if (Settings.MaxTransportBufferedBytes > 0)
+	{
+		MaxBytes = FMath::Max<int64>(0, Settings.MaxTransportBufferedBytes - Transport->GetBufferedAmount());
+	}
+
+	return OutboundQueue->Flush([this](const void* Data, SIZE_T Size) { Transport->Send(Data, Size); }, MaxBytes);
+}
+
+SendQueueStats Connection::GetSendQueueStats() const
+{
+	return OutboundQueue ? OutboundQueue->GetStats() : SendQueueStats();
+}
+
+void Connection::EnableEventQueue(uint32 Capacity)
+{
+	Queue = MakeUnique<FrameQueue>(Capacity);
+}
+
+int32 Connection::PumpEvents(int32 MaxEvents)
+{
+	if (!Queue)
+	{
+		return 0;
+	}
+
+	return Queue->Drain(
+		[this](FrameQueue::Event& Event)
 		{
-			if (this->OnClose)
+			QueueLatencyMicros.Record(RoomStats::CyclesToMicros(FPlatformTime::Cycles64() - Event.EnqueuedCycles));
+
+			switch (Event.Type)
 			{
-				this->OnClose(StatusCode, Reason, bWasClean);
+				case FrameQueue::EventType::Open:
+					if (OnOpen)
+					{
+						OnOpen();
+					}
+					break;
+				case FrameQueue::EventType::Message:
+					if (OnMessage)
+					{
+						DispatchingEnqueuedCycles = Event.EnqueuedCycles;
+						OnMessage(Event.Bytes.GetData(), Event.Bytes.Num(), 0);
+						DispatchingEnqueuedCycles = 0;
+					}
+					BufferPool.Release(MoveTemp(Event.Bytes));
+					break;
+				case FrameQueue::EventType::Close:
+					if (OnClose)
+					{
+						OnClose(Event.StatusCode, Event.Reason, Event.bWasClean);
+					}
+					break;
+				case FrameQueue::EventType::Error:
+					if (OnError)
+					{
+						OnError(Event.Reason);
+					}
+					break;
 			}
-		});
+		},
+		MaxEvents);
+}
+
+void Connection::HandleEvent(FrameQueue::EventType Type, int32 StatusCode, const FString& Reason, bool bWasClean)
+{
+	if (Queue)
+	{
+		FrameQueue::Event Event;
+		Event.Type = Type;
+		Event.StatusCode = StatusCode;
+		Event.Reason = Reason;
+		Event.bWasClean = bWasClean;
+		Queue->Enqueue(MoveTemp(Event));
+		return;
+	}
 
-	Socket->Connect();
+	switch (Type)
+	{
+		case FrameQueue::EventType::Open:
+			if (OnOpen)
+			{
+				OnOpen();
+			}
+			break;
+		case FrameQueue::EventType::Close:
+			if (OnClose)
+			{
+				OnClose(StatusCode, Reason, bWasClean);
+			}
+			break;
+		case FrameQueue::EventType::Error:
+			if (OnError)
+			{
+				OnError(Reason);
+			}
+			break;
+		default:
+			break;
+	}
 }
 
-void Connection::Close(int32 Code, const FString& Reason)
+void Connection::HandleFrame(const void* Data, SIZE_T Size, TArray<uint8>* OwnedBuffer)
 {
-	Socket->Close(Code, Reason);
+	BufferPool.NoteFrame(Size);
 
-	Socket = nullptr;
+	if (Recorder)
+	{
+		Recorder->Record(Data, Size);
+	}
+
+	if (Queue)
+	{
+		// Reassembled frames hand their buffer over; single-fragment frames are copied into a pooled one.
+		FrameQueue::Event Event;
+		Event.Type = FrameQueue::EventType::Message;
+		if (OwnedBuffer)
+		{
+			Event.Bytes = MoveTemp(*OwnedBuffer);
+		}
+		else
+		{
+			Event.Bytes = BufferPool.Acquire(Size);
+			Event.Bytes.Append(static_cast<const uint8*>(Data), Size);
+		}
+		Queue->Enqueue(MoveTemp(Event));
+		return;
+	}
+
+	OnMessage(Data, Size, 0);
+
+	if (OwnedBuffer)
+	{
+		BufferPool.Release(MoveTemp(*OwnedBuffer));
+	}
+}
+
+void Connection::Close(int32 Code, const FString& Reason)
+{
+	// The transport is kept until the connection is destroyed, so its close notification still arrives.
+	if (Transport)
+	{
+		Transport->Close(Code, Reason);
+	}
 }
@@ -0,0 +1,98 @@
+#include "FrameBufferPool.h"
+
+#include "ColyseusUtils.h"
+
+#include <Misc/ScopeLock.h>
+
+FrameBufferPool::FrameBufferPool(int32 MaxPooledBuffers, int64 HighWatermark, int32 ShrinkAfter)
+	: MaxPooledBuffers(MaxPooledBuffers)
+	, HighWatermark(HighWatermark)
+	, ShrinkAfter(ShrinkAfter)
+{
+}
+
+TArray<uint8> FrameBufferPool::Acquire(int64 ExpectedSize)
+{
+	TArray<uint8> Buffer;
+
+	{
+		FScopeLock ScopeLock(&Lock);
+
+		// Prefer the smallest buffer that already fits, otherwise the largest one to grow from.
+		int32 Best = INDEX_NONE;
+		for (int32 Index = 0; Index < FreeBuffers.Num(); Index++)
+		{
+			const int64 Capacity = FreeBuffers[Index].Max();
+			if (Best == INDEX_NONE)
+			{
+				Best = Index;
+				continue;
+			}
+
+			const int64 BestCapacity = FreeBuffers[Best].Max();
+			const bool bFits = Capacity >= ExpectedSize;
+			const bool bBestFits = BestCapacity >= ExpectedSize;
+			if ((bFits && (!bBestFits || Capacity < BestCapacity)) || (!bFits && !bBestFits && Capacity > BestCapacity))
+			{
+				Best = Index;
+			}
+		}
+
+		if (Best != INDEX_NONE)
+		{
+			Buffer = MoveTemp(FreeBuffers[Best]);
+			FreeBuffers.RemoveAtSwap(Best, 1, COLYSEUS_NO_SHRINK);
+		}
+	}
+
+	Buffer.Reserve((int32) ExpectedSize);
+	return Buffer;
+}
+
+void FrameBufferPool::Release(TArray<uint8>&& Buffer)
+{
+	Buffer.Reset();
+
+	// Large frames have stopped for a while, so oversized buffers are not worth keeping.
+	if (Buffer.Max() > HighWatermark && SmallFramesInARow.load(std::memory_order_relaxed) >= ShrinkAfter)
+	{
+		return;
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	if (FreeBuffers.Num() < MaxPooledBuffers)
+	{
+		FreeBuffers.Add(MoveTemp(Buffer));
+	}
+}
+
+void FrameBufferPool::NoteFrame(int64 Size)
+{
+	if (Size > HighWatermark)
+	{
+		SmallFramesInARow.store(0, std::memory_order_relaxed);
+		return;
+	}
+
+	if (SmallFramesInARow.load(std::memory_order_relaxed) >= ShrinkAfter ||
+		SmallFramesInARow.fetch_add(1, std::memory_order_relaxed) + 1 != ShrinkAfter)
+	{
+		return;
+	}
+
+	// Large frames have stopped for a while: drop the oversized buffers already pooled.
+	FScopeLock ScopeLock(&Lock);
+	FreeBuffers.RemoveAllSwap([this](const TArray<uint8>& Pooled) { return Pooled.Max() > HighWatermark; });
+}
+
+int64 FrameBufferPool::GetPooledBytes() const
+{
+	FScopeLock ScopeLock(&Lock);
+
+	int64 Bytes = 0;
+	for (const TArray<uint8>& Pooled : FreeBuffers)
+	{
+		Bytes += Pooled.Max();
+	}
+	return Bytes;
+}
@@ -0,0 +1,102 @@
+#include "FrameQueue.h"
+
+#include <HAL/PlatformTime.h>
+#include <Misc/ScopeLock.h>
+
+FrameQueue::FrameQueue(uint32 Capacity)
+	: Head(0)
+	, Tail(0)
+	, bOverflowing(false)
+	, OverflowCount(0)
+{
+	const uint32 Size = FMath::RoundUpToPowerOfTwo(FMath::Max<uint32>(Capacity, 2));
+	Slots.SetNum(Size);
+	Mask = Size - 1;
+}
+
+void FrameQueue::Enqueue(Event&& Item)
+{
+	Item.EnqueuedCycles = FPlatformTime::Cycles64();
+
+	// Once something has spilled, keep spilling until the consumer catches up, so events stay in order.
+	if (!bOverflowing.load(std::memory_order_acquire) && TryPush(Item))
+	{
+		return;
+	}
+
+	FScopeLock ScopeLock(&OverflowLock);
+	if (!bOverflowing.load(std::memory_order_relaxed) && TryPush(Item))
+	{
+		return;
+	}
+
+	bOverflowing.store(true, std::memory_order_release);
+	Overflow.Add(MoveTemp(Item));
+	OverflowCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+int32 FrameQueue::Drain(const TFunction<void(Event&)>& Visitor, int32 MaxEvents)
+{
+	int32 Visited = 0;
+	Event Item;
+
+	while (Visited < MaxEvents && TryPop(Item))
+	{
+		Visitor(Item);
+		Visited++;
+	}
+
+	if (Visited >= MaxEvents || !bOverflowing.load(std::memory_order_acquire))
+	{
+		return Visited;
+	}
+
+	TArray<Event> Spilled;
+	{
+		// The producer only writes to the overflow list while the flag is set, so anything still in
+		// the ring is older than the spilled events and has to go first.
+		FScopeLock ScopeLock(&OverflowLock);
+		while (TryPop(Item))
+		{
+			Spilled.Add(MoveTemp(Item));
+		}
+		Spilled.Append(MoveTemp(Overflow));
+		Overflow.Reset();
+		bOverflowing.store(false, std::memory_order_release);
+	}
+
+	// Spilled events are always delivered in full; MaxEvents only bounds the ring.
+	for (Event& Spill : Spilled)
+	{
+		Visitor(Spill);
+		Visited++;
+	}
+
+	return Visited;
+}
+
+bool FrameQueue::TryPush(Event& Item)
+{
+	const uint32 CurrentTail = Tail.load(std::memory_order_relaxed);
+	if (CurrentTail - Head.load(std::memory_order_acquire) > Mask)
+	{
+		return false;
+	}
+
+	Slots[CurrentTail & Mask] = MoveTemp(Item);
+	Tail.store(CurrentTail + 1, std::memory_order_release);
+	return true;
+}
+
+bool FrameQueue::TryPop(Event& Out)
+{
+	const uint32 CurrentHead = Head.load(std::memory_order_relaxed);
+	if (CurrentHead == Tail.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+
+	Out = MoveTemp(Slots[CurrentHead & Mask]);
+	Head.store(CurrentHead + 1, std::memory_order_release);
+	return true;
+}
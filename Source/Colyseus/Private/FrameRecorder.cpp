@@ -0,0 +1,142 @@
+#include "FrameRecorder.h"
+
+#include <HAL/PlatformFilemanager.h>
+#include <HAL/PlatformProcess.h>
+#include <HAL/PlatformTime.h>
+#include <Misc/FileHelper.h>
+#include <Misc/ScopeLock.h>
+
+namespace
+{
+const uint8 RecordingMagic[4] = {'C', 'Y', 'F', 'R'};
+const uint8 RecordingVersion = 1;
+const int64 RecordingHeaderSize = 5;
+const int64 FrameHeaderSize = sizeof(uint64) + sizeof(uint32);
+}	 // namespace
+
+FrameRecorder::~FrameRecorder()
+{
+	Close();
+}
+
+bool FrameRecorder::Open(const FString& Path)
+{
+	FScopeLock ScopeLock(&Lock);
+
+	File.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Path));
+	if (!File)
+	{
+		return false;
+	}
+
+	File->Write(RecordingMagic, sizeof(RecordingMagic));
+	File->Write(&RecordingVersion, sizeof(RecordingVersion));
+	StartTime = FPlatformTime::Seconds();
+	bRecording = true;
+	return true;
+}
+
+void FrameRecorder::Close()
+{
+	FScopeLock ScopeLock(&Lock);
+
+	bRecording = false;
+	if (File)
+	{
+		File->Flush();
+		File.Reset();
+	}
+}
+
+void FrameRecorder::Record(const void* Data, SIZE_T Size)
+{
+	if (!bRecording.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	FScopeLock ScopeLock(&Lock);
+
+	if (!File)
+	{
+		return;
+	}
+
+	uint64 Micros = (uint64) ((FPlatformTime::Seconds() - StartTime) * 1000000.0);
+	uint32 FrameSize = (uint32) Size;
+	File->Write(reinterpret_cast<const uint8*>(&Micros), sizeof(Micros));
+	File->Write(reinterpret_cast<const uint8*>(&FrameSize), sizeof(FrameSize));
+	File->Write(static_cast<const uint8*>(Data), Size);
+}
+
+bool FrameRecorder::IsOpen() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return File.IsValid();
+}
+
+bool FrameReplay::Load(const FString& Path)
+{
+	Contents.Reset();
+	Frames.Reset();
+
+	if (!FFileHelper::LoadFileToArray(Contents, *Path))
+	{
+		return false;
+	}
+
+	if (Contents.Num() < RecordingHeaderSize || FMemory::Memcmp(Contents.GetData(), RecordingMagic, sizeof(RecordingMagic)) != 0 ||
+		Contents[4] != RecordingVersion)
+	{
+		Contents.Reset();
+		return false;
+	}
+
+	// Index the frames up front so playback does no parsing or allocation of its own.
+	int64 Offset = RecordingHeaderSize;
+	while (Offset + FrameHeaderSize <= Contents.Num())
+	{
+		Frame Entry;
+		FMemory::Memcpy(&Entry.Micros, Contents.GetData() + Offset, sizeof(uint64));
+		FMemory::Memcpy(&Entry.Size, Contents.GetData() + Offset + sizeof(uint64), sizeof(uint32));
+		Entry.Offset = Offset + FrameHeaderSize;
+
+		if (Entry.Offset + Entry.Size > Contents.Num())
+		{
+			// Truncated tail, e.g. the recording was not closed cleanly.
+			break;
+		}
+
+		Frames.Add(Entry);
+		Offset = Entry.Offset + Entry.Size;
+	}
+
+	return true;
+}
+
+FrameReplay::Result FrameReplay::Play(
+	const TFunction<void(const void* Data, SIZE_T Size, SIZE_T BytesRemaining)>& Handler, bool bRealTime) const
+{
+	Result Stats;
+	const double StartTime = FPlatformTime::Seconds();
+
+	for (const Frame& Entry : Frames)
+	{
+		if (bRealTime)
+		{
+			const double Delay = StartTime + Entry.Micros / 1000000.0 - FPlatformTime::Seconds();
+			if (Delay > 0.0)
+			{
+				FPlatformProcess::Sleep((float) Delay);
+			}
+		}
+
+		Handler(Contents.GetData() + Entry.Offset, Entry.Size, 0);
+
+		Stats.Frames++;
+		Stats.Bytes += Entry.Size;
+	}
+
+	Stats.Seconds = FPlatformTime::Seconds() - StartTime;
+	return Stats;
+}
@@ -0,0 +1,104 @@
+#include "JoinTrace.h"
+
+#include <HAL/PlatformTime.h>
+
+void JoinTrace::Mark(EJoinPhase Phase)
+{
+	Timestamps[(int32) Phase] = FPlatformTime::Seconds();
+}
+
+double JoinTrace::GetPhaseSeconds(EJoinPhase Phase) const
+{
+	if (!Has(Phase))
+	{
+		return 0.0;
+	}
+
+	for (int32 Previous = (int32) Phase - 1; Previous >= 0; Previous--)
+	{
+		if (Timestamps[Previous] > 0.0)
+		{
+			return Timestamps[(int32) Phase] - Timestamps[Previous];
+		}
+	}
+	return 0.0;
+}
+
+double JoinTrace::GetTotalSeconds() const
+{
+	double First = 0.0;
+	double Last = 0.0;
+	for (double Timestamp : Timestamps)
+	{
+		if (Timestamp > 0.0)
+		{
+			First = First > 0.0 ? First : Timestamp;
+			Last = Timestamp;
+		}
+	}
+	return Last - First;
+}
+
+const TCHAR* JoinTrace::GetPhaseName(EJoinPhase Phase)
+{
+	switch (Phase)
+	{
+		case EJoinPhase::RequestSent: return TEXT("RequestSent");
+		case EJoinPhase::ResponseReceived: return TEXT("ResponseReceived");
+		case EJoinPhase::SocketOpen: return TEXT("SocketOpen");
+		case EJoinPhase::JoinRoom: return TEXT("JoinRoom");
+		case EJoinPhase::FirstStateDecoded: return TEXT("FirstStateDecoded");
+		case EJoinPhase::FirstStateChange: return TEXT("FirstStateChange");
+		default: return TEXT("Unknown");
+	}
+}
+
+JoinTimings JoinTimings::FromTrace(const JoinTrace& Trace)
+{
+	JoinTimings Result;
+	Result.ModuleLoadSeconds = Trace.ModuleLoadSeconds;
+	Result.MatchMakeSeconds = Trace.GetPhaseSeconds(EJoinPhase::ResponseReceived);
+	if (Trace.Has(EJoinPhase::ResponseReceived) && Trace.Has(EJoinPhase::JoinRoom))
+	{
+		Result.ConnectSeconds = Trace.Timestamps[(int32) EJoinPhase::JoinRoom] - Trace.Timestamps[(int32) EJoinPhase::ResponseReceived];
+	}
+	Result.TotalSeconds = Trace.GetTotalSeconds();
+	return Result;
+}
+
+void JoinTraceStats::Record(const JoinTrace& Trace)
+{
+	for (int32 Phase = 1; Phase < JoinTrace::NumPhases; Phase++)
+	{
+		if (Trace.Has((EJoinPhase) Phase))
+		{
+			PhaseMicros[Phase].Record((uint64) (Trace.GetPhaseSeconds((EJoinPhase) Phase) * 1e6));
+		}
+	}
+	TotalMicros.Record((uint64) (Trace.GetTotalSeconds() * 1e6));
+}
+
+JoinTraceStatsSnapshot JoinTraceStats::Snapshot() const
+{
+	JoinTraceStatsSnapshot Result;
+	Result.Joins = TotalMicros.GetCount();
+	for (int32 Phase = 0; Phase < JoinTrace::NumPhases; Phase++)
+	{
+		Result.PhaseMicrosP50[Phase] = PhaseMicros[Phase].GetPercentile(0.5);
+		Result.PhaseMicrosP99[Phase] = PhaseMicros[Phase].GetPercentile(0.99);
+		Result.PhaseMicrosMax[Phase] = PhaseMicros[Phase].GetMax();
+	}
+	Result.TotalMicrosP50 = TotalMicros.GetPercentile(0.5);
+	Result.TotalMicrosP99 = TotalMicros.GetPercentile(0.99);
+	Result.TotalMicrosMax = TotalMicros.GetMax();
+	return Result;
+}
+
+void JoinTraceStats::Reset()
+{
+	for (Log2Histogram& Histogram : PhaseMicros)
+	{
+		Histogram.Reset();
+	}
+	TotalMicros.Reset();
+}
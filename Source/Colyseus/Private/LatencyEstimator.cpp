@@ -0,0 +1,56 @@
+#include "LatencyEstimator.h"
+
+#include "ColyseusUtils.h"
+
+const FString LatencyEstimator::PingType = TEXT("__ping");
+const FString LatencyEstimator::PongType = TEXT("__pong");
+
+void LatencyEstimator::AddSample(double SentSeconds, double ReceivedSeconds, double ServerSeconds)
+{
+	const double Rtt = ReceivedSeconds - SentSeconds;
+	if (Rtt < 0.0)
+	{
+		return;
+	}
+
+	if (SampleCount == 0)
+	{
+		SmoothedRtt = Rtt;
+		RttVariance = Rtt / 2.0;
+	}
+	else
+	{
+		RttVariance += (FMath::Abs(SmoothedRtt - Rtt) - RttVariance) / 4.0;
+		SmoothedRtt += (Rtt - SmoothedRtt) / 8.0;
+	}
+	SampleCount++;
+	RttMicros.Record((uint64) (Rtt * 1e6));
+
+	// Assume the server answered halfway through the round trip.
+	const double Offset = ServerSeconds - (SentSeconds + Rtt / 2.0);
+	if (RecentOffsets.Num() >= OffsetWindow)
+	{
+		RecentOffsets.RemoveAt(0, 1, COLYSEUS_NO_SHRINK);
+	}
+	RecentOffsets.Add({Rtt, Offset});
+
+	const OffsetSample* Fastest = &RecentOffsets[0];
+	for (const OffsetSample& Sample : RecentOffsets)
+	{
+		if (Sample.Rtt < Fastest->Rtt)
+		{
+			Fastest = &Sample;
+		}
+	}
+	ClockOffset = Fastest->Offset;
+}
+
+void LatencyEstimator::Reset()
+{
+	SmoothedRtt = 0.0;
+	RttVariance = 0.0;
+	ClockOffset = 0.0;
+	SampleCount = 0;
+	RecentOffsets.Reset();
+	RttMicros.Reset();
+}
@@ -0,0 +1,194 @@
+#include "LoopbackTransport.h"
+
+#include "ColyseusUtils.h"
+#include "LatencyEstimator.h"
+#include "MessageType.h"
+#include "Protocol.h"
+#include "Serializer/schema.h"
+
+#include <HAL/PlatformTime.h>
+
+THIRD_PARTY_INCLUDES_START
+#pragma push_macro("check")
+#undef check
+#include <msgpack.hpp>
+#pragma pop_macro("check")
+THIRD_PARTY_INCLUDES_END
+
+void LoopbackTransport::Connect(const FString& InUrl)
+{
+	Url = InUrl;
+	bConnected = true;
+	LastTickTime = FPlatformTime::Seconds();
+
+	if (OnConnected)
+	{
+		OnConnected();
+	}
+
+	// A real room accepts the join as soon as the socket opens.
+	if (bEchoStandIn)
+	{
+		FTCHARToUTF8 SerializerBytes(*StandInSerializerId);
+		std::vector<unsigned char> JoinRoom;
+		JoinRoom.push_back((unsigned char) Colyseus::Protocol::JOIN_ROOM);
+		colyseus::schema::encodeString(JoinRoom, SerializerBytes.Get(), SerializerBytes.Length());
+		Deliver(JoinRoom.data(), JoinRoom.size());
+	}
+}
+
+void LoopbackTransport::Send(const void* Data, SIZE_T Size)
+{
+	if (!bConnected)
+	{
+		return;
+	}
+
+	if (SimulatedBytesPerSecond <= 0)
+	{
+		ReceiveOnServer(static_cast<const uint8*>(Data), Size);
+		return;
+	}
+
+	InFlight.Emplace(static_cast<const uint8*>(Data), (int32) Size);
+	InFlightBytes += Size;
+}
+
+void LoopbackTransport::Close(int32 Code, const FString& Reason)
+{
+	Disconnect(Code, Reason);
+}
+
+int64 LoopbackTransport::GetBufferedAmount() const
+{
+	return InFlightBytes - InFlightSentOfFirst;
+}
+
+void LoopbackTransport::Deliver(const void* Data, SIZE_T Size, SIZE_T FragmentSize)
+{
+	if (!bConnected || !OnRawMessage)
+	{
+		return;
+	}
+
+	const uint8* Bytes = static_cast<const uint8*>(Data);
+	if (FragmentSize == 0 || FragmentSize >= Size)
+	{
+		OnRawMessage(Bytes, Size, 0);
+		return;
+	}
+
+	for (SIZE_T Offset = 0; Offset < Size; Offset += FragmentSize)
+	{
+		const SIZE_T Chunk = FMath::Min(FragmentSize, Size - Offset);
+		OnRawMessage(Bytes + Offset, Chunk, Size - Offset - Chunk);
+	}
+}
+
+void LoopbackTransport::Disconnect(int32 Code, const FString& Reason)
+{
+	if (!bConnected)
+	{
+		return;
+	}
+
+	bConnected = false;
+	InFlight.Reset();
+	InFlightBytes = 0;
+	InFlightSentOfFirst = 0;
+
+	if (OnClosed)
+	{
+		OnClosed(Code, Reason, true);
+	}
+}
+
+void LoopbackTransport::Tick()
+{
+	const double Now = FPlatformTime::Seconds();
+	int64 Budget = (int64) ((Now - LastTickTime) * SimulatedBytesPerSecond);
+	LastTickTime = Now;
+
+	while (Budget > 0 && InFlight.Num() > 0 && bConnected)
+	{
+		const int64 Remaining = InFlight[0].Num() - InFlightSentOfFirst;
+		if (Budget < Remaining)
+		{
+			InFlightSentOfFirst += Budget;
+			break;
+		}
+
+		Budget -= Remaining;
+		TArray<uint8> Frame = MoveTemp(InFlight[0]);
+		InFlight.RemoveAt(0);
+		InFlightBytes -= Frame.Num();
+		InFlightSentOfFirst = 0;
+
+		ReceiveOnServer(Frame.GetData(), Frame.Num());
+	}
+}
+
+void LoopbackTransport::EnableEchoStandIn(const FString& SerializerId)
+{
+	StandInSerializerId = SerializerId;
+	bEchoStandIn = true;
+
+	OnServerReceive = [](LoopbackTransport& Transport, const uint8* Data, SIZE_T Size)
+	{
+		if (Size == 0)
+		{
+			return;
+		}
+
+		switch ((Colyseus::Protocol) Data[0])
+		{
+			case Colyseus::Protocol::ROOM_DATA:
+				if (!Transport.AnswerPing(Data, Size))
+				{
+					Transport.Deliver(Data, Size);
+				}
+				break;
+			case Colyseus::Protocol::LEAVE_ROOM:
+				Transport.Disconnect(1000);
+				break;
+			default:
+				break;
+		}
+	};
+}
+
+// Mirrors the server-side handler in the README: the ping's payload comes back with the server time in milliseconds.
+bool LoopbackTransport::AnswerPing(const uint8* Data, SIZE_T Size)
+{
+	colyseus::schema::Iterator It;
+	It.offset = 1;
+	if (Size <= It.offset || colyseus::schema::numberCheck(Data, &It))
+	{
+		return false;
+	}
+
+	const std::string Type = colyseus::schema::decodeString(Data, &It);
+	if (StdStringToFString(Type) != LatencyEstimator::PingType || Size <= It.offset)
+	{
+		return false;
+	}
+
+	msgpack::zone Zone;
+	msgpack::object Payload = msgpack::unpack(Zone, reinterpret_cast<const char*>(Data), Size, It.offset);
+	const double ServerMillis = (FPlatformTime::Seconds() + StandInClockOffset) * 1000.0;
+
+	static const MessageType Pong(LatencyEstimator::PongType);
+	msgpack::sbuffer Buffer;
+	Buffer.write(reinterpret_cast<const char*>(Pong.GetPrefix().GetData()), Pong.GetPrefix().Num());
+	msgpack::pack(Buffer, msgpack::type::make_tuple(Payload, ServerMillis));
+	Deliver(Buffer.data(), Buffer.size());
+	return true;
+}
+
+void LoopbackTransport::ReceiveOnServer(const uint8* Data, SIZE_T Size)
+{
+	if (OnServerReceive)
+	{
+		OnServerReceive(*this, Data, Size);
+	}
+}
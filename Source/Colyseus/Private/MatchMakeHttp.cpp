@@ -0,0 +1,149 @@
+#include "MatchMakeHttp.h"
+
+#include <HttpModule.h>
+#include <Misc/Guid.h>
+#include <Misc/Paths.h>
+
+namespace
+{
+MatchMakeHttpResponse ToMatchMakeResponse(const FHttpResponsePtr& Response)
+{
+	MatchMakeHttpResponse Result;
+	if (!Response.IsValid())
+	{
+		return Result;
+	}
+
+	Result.Code = Response->GetResponseCode();
+	Result.Content = Response->GetContent();
+	for (const FString& Header : Response->GetAllHeaders())
+	{
+		FString Name;
+		FString Value;
+		if (Header.Split(TEXT(":"), &Name, &Value))
+		{
+			Result.Headers.Add(Name.TrimStartAndEnd(), Value.TrimStartAndEnd());
+		}
+	}
+	return Result;
+}
+
+void SetContent(MatchMakeHttpResponse& Response, const FString& Json)
+{
+	FTCHARToUTF8 Utf8(*Json);
+	Response.Content.Reset();
+	Response.Content.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+	Response.Headers.Add(TEXT("Content-Type"), TEXT("application/json"));
+}
+}
+
+MatchMakeHttp::RequestRef MatchMakeHttp::CreateRequest(const FString& Verb, const FString& Url) const
+{
+	RequestRef Request = FHttpModule::Get().CreateRequest();
+	Request->SetURL(Url);
+	Request->SetVerb(Verb);
+	Request->SetHeader(TEXT("Accept"), TEXT("application/json"));
+	return Request;
+}
+
+void MatchMakeHttp::Enqueue(RequestRef Request, const ResponseHandler& Handler, const TFunction<void()>& OnSent)
+{
+	Requests++;
+
+	if (IsFull())
+	{
+		QueuedRequests++;
+		Waiting.Add({Request, Handler, OnSent});
+		return;
+	}
+
+	Process({Request, Handler, OnSent});
+}
+
+void MatchMakeHttp::EnableLoopbackStandIn()
+{
+	StandIn = [](const IHttpRequest& Request, MatchMakeHttpResponse& OutResponse)
+	{
+		OutResponse.Code = 200;
+
+		// GET /matchmake/<room> lists rooms; the stand-in never has any.
+		if (Request.GetVerb() == TEXT("GET"))
+		{
+			SetContent(OutResponse, TEXT("[]"));
+			return;
+		}
+
+		const FString RoomName = FPaths::GetCleanFilename(Request.GetURL());
+		SetContent(OutResponse, FString::Printf(
+			TEXT("{\"room\":{\"name\":\"%s\",\"roomId\":\"%s\",\"processId\":\"loopback\"},\"sessionId\":\"%s\"}"),
+			*RoomName.ReplaceCharWithEscapedChar(),
+			*FGuid::NewGuid().ToString(EGuidFormats::Digits),
+			*FGuid::NewGuid().ToString(EGuidFormats::Digits)));
+	};
+}
+
+MatchMakeHttpStats MatchMakeHttp::GetStats() const
+{
+	MatchMakeHttpStats Stats;
+	Stats.Requests = Requests;
+	Stats.QueuedRequests = QueuedRequests;
+	Stats.InFlight = InFlight;
+	Stats.Waiting = Waiting.Num();
+	return Stats;
+}
+
+void MatchMakeHttp::Process(const PendingRequest& Pending)
+{
+	InFlight++;
+
+	if (Pending.OnSent)
+	{
+		Pending.OnSent();
+	}
+
+	if (StandIn)
+	{
+		MatchMakeHttpResponse Response;
+		StandIn(*Pending.Request, Response);
+		InFlight--;
+		Pending.Handler(Response, true);
+		StartWaiting();
+		return;
+	}
+
+	TWeakPtr<MatchMakeHttp> WeakThis = AsShared();
+	ResponseHandler Handler = Pending.Handler;
+	Pending.Request->OnProcessRequestComplete().BindLambda(
+		[WeakThis, Handler](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful)
+		{
+			// Handlers may use this layer's owner, so they are dropped once it is gone.
+			TSharedPtr<MatchMakeHttp> This = WeakThis.Pin();
+			if (!This)
+			{
+				return;
+			}
+
+			// Free the slot before the handler runs, so a request it makes can use it.
+			This->InFlight--;
+			Handler(ToMatchMakeResponse(Response), bWasSuccessful && Response.IsValid());
+			This->StartWaiting();
+		});
+
+	if (!Pending.Request->ProcessRequest())
+	{
+		InFlight--;
+		Pending.Request->OnProcessRequestComplete().Unbind();
+		Handler(MatchMakeHttpResponse(), false);
+		StartWaiting();
+	}
+}
+
+void MatchMakeHttp::StartWaiting()
+{
+	while (Waiting.Num() > 0 && !IsFull())
+	{
+		PendingRequest Next = Waiting[0];
+		Waiting.RemoveAt(0);
+		Process(Next);
+	}
+}
@@ -0,0 +1,177 @@
+#include "MatchMakeResponse.h"
+
+#include <nlohmann/json.hpp>
+
+namespace
+{
+// Only values at known keys are kept; the handler tracks nesting depth to know where a key sits.
+class MatchMakeSax
+{
+public:
+	MatchMakeSax(MatchMakeResponse& Response) : Response(Response)
+	{
+	}
+
+	bool null()
+	{
+		return Value();
+	}
+
+	bool boolean(bool)
+	{
+		return Value();
+	}
+
+	bool number_integer(nlohmann::json::number_integer_t Number)
+	{
+		if (Pending == Field::Code)
+		{
+			Response.Code = (int32) Number;
+		}
+		return Value();
+	}
+
+	bool number_unsigned(nlohmann::json::number_unsigned_t Number)
+	{
+		if (Pending == Field::Code)
+		{
+			Response.Code = (int32) Number;
+		}
+		return Value();
+	}
+
+	bool number_float(nlohmann::json::number_float_t Number, const nlohmann::json::string_t&)
+	{
+		if (Pending == Field::Code)
+		{
+			Response.Code = (int32) Number;
+		}
+		return Value();
+	}
+
+	bool string(nlohmann::json::string_t& String)
+	{
+		switch (Pending)
+		{
+			case Field::RoomId: Response.RoomId = std::move(String); break;
+			case Field::ProcessId: Response.ProcessId = std::move(String); break;
+			case Field::SessionId: Response.SessionId = std::move(String); break;
+			case Field::Error:
+				Response.Error = std::move(String);
+				Response.bHasError = true;
+				break;
+			default: break;
+		}
+		return Value();
+	}
+
+	// Only called by library versions with binary value support.
+	template <typename Binary>
+	bool binary(Binary&)
+	{
+		return Value();
+	}
+
+	bool start_object(std::size_t)
+	{
+		Depth++;
+		if (Depth == 2 && Pending == Field::Room)
+		{
+			bInRoom = true;
+		}
+		Pending = Field::None;
+		return true;
+	}
+
+	bool key(nlohmann::json::string_t& Key)
+	{
+		Pending = Field::None;
+		if (Depth == 1)
+		{
+			if (Key == "sessionId") { Pending = Field::SessionId; }
+			else if (Key == "room") { Pending = Field::Room; }
+			else if (Key == "error") { Pending = Field::Error; }
+			else if (Key == "code") { Pending = Field::Code; }
+		}
+		else if (Depth == 2 && bInRoom)
+		{
+			if (Key == "roomId") { Pending = Field::RoomId; }
+			else if (Key == "processId") { Pending = Field::ProcessId; }
+		}
+		return true;
+	}
+
+	bool end_object()
+	{
+		if (Depth == 2)
+		{
+			bInRoom = false;
+		}
+		Depth--;
+		return true;
+	}
+
+	bool start_array(std::size_t)
+	{
+		Depth++;
+		Pending = Field::None;
+		return true;
+	}
+
+	bool end_array()
+	{
+		Depth--;
+		return true;
+	}
+
+	template <typename Exception>
+	bool parse_error(std::size_t, const std::string&, const Exception& Error)
+	{
+		ErrorMessage = Error.what();
+		return false;
+	}
+
+	std::string ErrorMessage;
+
+private:
+	enum class Field
+	{
+		None,
+		Room,
+		RoomId,
+		ProcessId,
+		SessionId,
+		Error,
+		Code,
+	};
+
+	bool Value()
+	{
+		Pending = Field::None;
+		return true;
+	}
+
+	MatchMakeResponse& Response;
+	Field Pending = Field::None;
+	int32 Depth = 0;
+	bool bInRoom = false;
+};
+}
+
+bool MatchMakeResponse::Parse(const uint8* Data, SIZE_T Size, std::string& ParseError)
+{
+	MatchMakeSax Handler(*this);
+	const char* Begin = reinterpret_cast<const char*>(Data);
+	if (!nlohmann::json::sax_parse(Begin, Begin + Size, &Handler))
+	{
+		ParseError = Handler.ErrorMessage.empty() ? std::string("invalid JSON") : Handler.ErrorMessage;
+		return false;
+	}
+
+	if (!bHasError && (RoomId.empty() || ProcessId.empty() || SessionId.empty()))
+	{
+		ParseError = "missing room.roomId, room.processId or sessionId";
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,25 @@
+#include "MessageType.h"
+
+#include "Protocol.h"
+#include "Serializer/schema.h"
+
+MessageType::MessageType(const FString& Name) : Name(Name)
+{
+	// Length prefix must count UTF-8 bytes, and names of 32 bytes or more need a str8/16/32 header.
+	FTCHARToUTF8 TypeBytes(*Name);
+
+	std::vector<unsigned char> Encoded;
+	Encoded.push_back((unsigned char) Colyseus::Protocol::ROOM_DATA);
+	colyseus::schema::encodeString(Encoded, TypeBytes.Get(), TypeBytes.Length());
+
+	Prefix.Append(Encoded.data(), Encoded.size());
+}
+
+MessageType::MessageType(int32 Type) : Name(FString::FromInt(Type))
+{
+	std::vector<unsigned char> Encoded;
+	Encoded.push_back((unsigned char) Colyseus::Protocol::ROOM_DATA);
+	colyseus::schema::encodeNumber(Encoded, Type);
+
+	Prefix.Append(Encoded.data(), Encoded.size());
+}
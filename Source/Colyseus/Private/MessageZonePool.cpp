@@ -0,0 +1,78 @@
+#include "MessageZonePool.h"
+
+#include "ColyseusUtils.h"
+
+#include <HAL/PlatformTime.h>
+
+MessageZonePool::MessageZonePool(SIZE_T ChunkSize, int32 MaxPooledZones)
+	: ChunkSize(ChunkSize)
+	, MaxPooledZones(MaxPooledZones)
+	, Allocations(0)
+	, Acquisitions(0)
+	, OversizedPayloads(0)
+	, LastSampleTime(FPlatformTime::Seconds())
+{
+}
+
+msgpack::zone* MessageZonePool::Acquire()
+{
+	Acquisitions.fetch_add(1, std::memory_order_relaxed);
+
+	if (FreeZones.Num() > 0)
+	{
+		return FreeZones.Pop(COLYSEUS_NO_SHRINK).Release();
+	}
+
+	Allocations.fetch_add(1, std::memory_order_relaxed);
+	return new msgpack::zone(ChunkSize);
+}
+
+void MessageZonePool::Release(msgpack::zone* Zone)
+{
+	if (FreeZones.Num() >= MaxPooledZones)
+	{
+		delete Zone;
+		return;
+	}
+
+	// clear() runs finalizers and frees every chunk except the first, which is kept for the next message.
+	Zone->clear();
+	FreeZones.Emplace(Zone);
+}
+
+void MessageZonePool::NotePayloadSize(SIZE_T PayloadSize)
+{
+	if (PayloadSize > ChunkSize)
+	{
+		OversizedPayloads.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+double MessageZonePool::SampleAllocationsPerSecond()
+{
+	const double Now = FPlatformTime::Seconds();
+	const double Elapsed = Now - LastSampleTime;
+	const uint64 Total = Allocations.load(std::memory_order_relaxed);
+	const uint64 Allocated = Total >= LastSampleAllocations ? Total - LastSampleAllocations : Total;
+
+	LastSampleTime = Now;
+	LastSampleAllocations = Total;
+
+	return Elapsed > 0.0 ? Allocated / Elapsed : 0.0;
+}
+
+MessageZonePool::Stats MessageZonePool::GetStats() const
+{
+	Stats Result;
+	Result.Allocations = Allocations.load(std::memory_order_relaxed);
+	Result.Acquisitions = Acquisitions.load(std::memory_order_relaxed);
+	Result.OversizedPayloads = OversizedPayloads.load(std::memory_order_relaxed);
+	return Result;
+}
+
+void MessageZonePool::ResetStats()
+{
+	Allocations.store(0, std::memory_order_relaxed);
+	Acquisitions.store(0, std::memory_order_relaxed);
+	OversizedPayloads.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,116 @@
+#include "PatchJitterBuffer.h"
+
+#include "ColyseusUtils.h"
+
+PatchJitterBuffer::PatchJitterBuffer(const PatchJitterBufferSettings& Settings)
+	: Settings(Settings)
+	, Interval(Settings.InitialInterval)
+{
+}
+
+void PatchJitterBuffer::Push(const void* Data, SIZE_T Size, double ArrivalSeconds)
+{
+	bool bIdleGap = false;
+	if (LastArrival >= 0.0)
+	{
+		const double Delta = ArrivalSeconds - LastArrival;
+		bIdleGap = Delta > Interval * Settings.IdleGapIntervals;
+		IdleGaps = bIdleGap ? IdleGaps + 1 : 0;
+		if (!bIdleGap || IdleGaps >= IdleGapsToAdapt)
+		{
+			Jitter += (FMath::Abs(Delta - Interval) - Jitter) / 8.0;
+			Interval += (Delta - Interval) / 8.0;
+		}
+	}
+	LastArrival = ArrivalSeconds;
+
+	BufferedPatch& Patch = Patches.AddDefaulted_GetRef();
+	Patch.Bytes.Append(static_cast<const uint8*>(Data), Size);
+	Patch.ArrivalSeconds = ArrivalSeconds;
+	Patch.bAfterIdleGap = bIdleGap;
+}
+
+int32 PatchJitterBuffer::Drain(double Now, const PatchVisitor& Visitor)
+{
+	const double Delay = GetDelay();
+	const double SafeInterval = FMath::Max(Interval, 0.001);
+	const int32 MaxBuffered = FMath::Max(1, FMath::CeilToInt(Delay / SafeInterval) + 1);
+
+	int32 Applied = 0;
+	while (Patches.Num() > 0)
+	{
+		const bool bCatchUp = Patches.Num() > MaxBuffered;
+		const double Due = GetDueTime(Patches[0]);
+		if (!bCatchUp && Due > Now)
+		{
+			break;
+		}
+
+		if (bCatchUp)
+		{
+			CatchUpPatches++;
+		}
+		else if (LastRelease >= 0.0 && !Patches[0].bAfterIdleGap && Patches[0].ArrivalSeconds > LastRelease + SafeInterval)
+		{
+			LatePatches++;
+		}
+
+		// Keep the cadence from the scheduled time rather than from Now, so a late Tick does not shift it.
+		LastRelease = bCatchUp ? Now : Due;
+
+		BufferedPatch Patch = MoveTemp(Patches[0]);
+		Patches.RemoveAt(0, 1, COLYSEUS_NO_SHRINK);
+		Visitor(Patch.Bytes);
+		Applied++;
+	}
+	return Applied;
+}
+
+int32 PatchJitterBuffer::Flush(const PatchVisitor& Visitor)
+{
+	const int32 Applied = Patches.Num();
+	for (const BufferedPatch& Patch : Patches)
+	{
+		Visitor(Patch.Bytes);
+	}
+	Patches.Reset();
+	LastRelease = -1.0;
+	return Applied;
+}
+
+void PatchJitterBuffer::Reset()
+{
+	Patches.Reset();
+	Interval = Settings.InitialInterval;
+	Jitter = 0.0;
+	LastArrival = -1.0;
+	LastRelease = -1.0;
+	IdleGaps = 0;
+}
+
+PatchJitterBufferStats PatchJitterBuffer::GetStats() const
+{
+	PatchJitterBufferStats Stats;
+	Stats.BufferedPatches = Patches.Num();
+	Stats.Delay = GetDelay();
+	Stats.Jitter = Jitter;
+	Stats.Interval = Interval;
+	Stats.LatePatches = LatePatches;
+	Stats.CatchUpPatches = CatchUpPatches;
+	return Stats;
+}
+
+double PatchJitterBuffer::GetDelay() const
+{
+	return FMath::Clamp(Settings.JitterMultiplier * Jitter, Settings.MinDelay, Settings.MaxDelay);
+}
+
+double PatchJitterBuffer::GetDueTime(const BufferedPatch& Patch) const
+{
+	const double HoldUntil = Patch.ArrivalSeconds + GetDelay();
+	if (LastRelease < 0.0)
+	{
+		return HoldUntil;
+	}
+	return FMath::Max(HoldUntil, FMath::Min(LastRelease + Interval, Patch.ArrivalSeconds + Settings.MaxDelay));
+}
@@ -0,0 +1,149 @@
+#include "RoomListing.h"
+
+#include "ColyseusUtils.h"
+
+#include <HAL/PlatformTime.h>
+
+void RoomListingCache::Get(MatchMakeHttp& Http, const FString& Url, const FString& RoomName, double MaxAge, const ResultHandler& Handler)
+{
+	Entry& Cached = Entries.FindOrAdd(RoomName);
+
+	if (Cached.FetchedAt >= 0.0 && FPlatformTime::Seconds() - Cached.FetchedAt <= MaxAge)
+	{
+		CacheHits++;
+		RoomListingResult Result;
+		Result.bSuccess = true;
+		Result.bFromCache = true;
+		Result.Rooms = Cached.Rooms;
+		Handler(Result);
+		return;
+	}
+
+	Cached.Waiters.Add(Handler);
+	if (Cached.bInFlight)
+	{
+		return;
+	}
+	Cached.bInFlight = true;
+	Requests++;
+
+	MatchMakeHttp::RequestRef Request = Http.CreateRequest(TEXT("GET"), Url);
+	if (!Cached.ETag.IsEmpty())
+	{
+		Request->SetHeader(TEXT("If-None-Match"), Cached.ETag);
+	}
+
+	TWeakPtr<RoomListingCache> WeakThis = AsShared();
+	Http.Enqueue(Request,
+		[WeakThis, RoomName](const MatchMakeHttpResponse& Response, bool bWasSuccessful)
+		{
+			if (TSharedPtr<RoomListingCache> This = WeakThis.Pin())
+			{
+				This->Complete(RoomName, Response, bWasSuccessful);
+			}
+		});
+}
+
+void RoomListingCache::Invalidate(const FString& RoomName)
+{
+	for (TPair<FString, Entry>& Pair : Entries)
+	{
+		if (RoomName.IsEmpty() || Pair.Key == RoomName)
+		{
+			Pair.Value.FetchedAt = -1.0;
+			Pair.Value.ETag.Empty();
+		}
+	}
+}
+
+bool RoomListingCache::ParseListing(const TArray<uint8>& Content, TArray<RoomListing>& OutRooms, FString& OutError)
+{
+	nlohmann::json Parsed = nlohmann::json::parse(Content.GetData(), Content.GetData() + Content.Num(), nullptr, false);
+	if (!Parsed.is_array())
+	{
+		OutError = TEXT("Room listing is not a JSON array");
+		return false;
+	}
+
+	auto GetString = [](const nlohmann::json& Object, const char* Key) {
+		auto Found = Object.find(Key);
+		return Found != Object.end() && Found->is_string() ? StdStringToFString(Found->get<std::string>()) : FString();
+	};
+	auto GetInt = [](const nlohmann::json& Object, const char* Key) {
+		auto Found = Object.find(Key);
+		return Found != Object.end() && Found->is_number() ? Found->get<int32>() : 0;
+	};
+	auto GetBool = [](const nlohmann::json& Object, const char* Key) {
+		auto Found = Object.find(Key);
+		return Found != Object.end() && Found->is_boolean() && Found->get<bool>();
+	};
+
+	OutRooms.Reset(Parsed.size());
+	for (nlohmann::json& Object : Parsed)
+	{
+		if (!Object.is_object())
+		{
+			continue;
+		}
+
+		RoomListing& Room = OutRooms.AddDefaulted_GetRef();
+		Room.RoomId = GetString(Object, "roomId");
+		Room.Name = GetString(Object, "name");
+		Room.ProcessId = GetString(Object, "processId");
+		Room.Clients = GetInt(Object, "clients");
+		Room.MaxClients = GetInt(Object, "maxClients");
+		Room.bLocked = GetBool(Object, "locked");
+		Room.bPrivate = GetBool(Object, "private");
+
+		auto Metadata = Object.find("metadata");
+		if (Metadata != Object.end())
+		{
+			Room.Metadata = std::move(*Metadata);
+		}
+	}
+	return true;
+}
+
+void RoomListingCache::Complete(const FString& RoomName, const MatchMakeHttpResponse& Response, bool bWasSuccessful)
+{
+	Entry* Cached = Entries.Find(RoomName);
+	if (!Cached)
+	{
+		return;
+	}
+	Cached->bInFlight = false;
+
+	RoomListingResult Result;
+	if (!bWasSuccessful)
+	{
+		Result.ErrorMessage = TEXT("HttpRequest => no/invalid response");
+	}
+	else if (Response.Code == EHttpResponseCodes::NotModified)
+	{
+		NotModified++;
+		Cached->FetchedAt = FPlatformTime::Seconds();
+		Result.bSuccess = true;
+		Result.bFromCache = true;
+		Result.Rooms = Cached->Rooms;
+	}
+	else if (!EHttpResponseCodes::IsOk(Response.Code))
+	{
+		Result.ErrorCode = Response.Code;
+		Result.ErrorMessage = TEXT("Server Error");
+	}
+	else if (ParseListing(Response.Content, Result.Rooms, Result.ErrorMessage))
+	{
+		Result.bSuccess = true;
+		Cached->Rooms = Result.Rooms;
+		Cached->ETag = Response.GetHeader(TEXT("ETag"));
+		Cached->FetchedAt = FPlatformTime::Seconds();
+	}
+
+	// A handler may ask again (and re-enter Get), so detach the waiters first.
+	TArray<ResultHandler> Waiters = MoveTemp(Cached->Waiters);
+	Cached->Waiters.Reset();
+	for (const ResultHandler& Waiter : Waiters)
+	{
+		Waiter(Result);
+	}
+}
@@ -0,0 +1,193 @@
+#include "RoomStats.h"
+
+#include <HAL/PlatformTime.h>
+
+Log2Histogram::Log2Histogram()
+{
+	Reset();
+}
+
+void Log2Histogram::Record(uint64 Value)
+{
+	// Bucket N holds values in [2^(N-1), 2^N), bucket 0 holds zero.
+	int32 Bucket = Value == 0 ? 0 : 64 - FMath::CountLeadingZeros64(Value);
+	Bucket = FMath::Min(Bucket, NumBuckets - 1);
+	Buckets[Bucket].fetch_add(1, std::memory_order_relaxed);
+
+	uint64 Current = Max.load(std::memory_order_relaxed);
+	while (Value > Current && !Max.compare_exchange_weak(Current, Value, std::memory_order_relaxed))
+	{
+	}
+}
+
+void Log2Histogram::Reset()
+{
+	for (std::atomic<uint64>& Bucket : Buckets)
+	{
+		Bucket.store(0, std::memory_order_relaxed);
+	}
+	Max.store(0, std::memory_order_relaxed);
+}
+
+uint64 Log2Histogram::GetCount() const
+{
+	uint64 Count = 0;
+	for (const std::atomic<uint64>& Bucket : Buckets)
+	{
+		Count += Bucket.load(std::memory_order_relaxed);
+	}
+	return Count;
+}
+
+uint64 Log2Histogram::GetMax() const
+{
+	return Max.load(std::memory_order_relaxed);
+}
+
+uint64 Log2Histogram::GetPercentile(double Percentile) const
+{
+	const uint64 Count = GetCount();
+	if (Count == 0)
+	{
+		return 0;
+	}
+
+	const uint64 Rank = FMath::Max<uint64>(1, (uint64) FMath::CeilToDouble(Count * Percentile));
+	uint64 Seen = 0;
+	for (int32 Bucket = 0; Bucket < NumBuckets; Bucket++)
+	{
+		Seen += Buckets[Bucket].load(std::memory_order_relaxed);
+		if (Seen >= Rank)
+		{
+			const uint64 UpperBound = Bucket == 0 ? 0 : (1ull << Bucket) - 1;
+			return FMath::Min(UpperBound, GetMax());
+		}
+	}
+	return GetMax();
+}
+
+RoomStats::RoomStats()
+{
+	Reset();
+}
+
+void RoomStats::RecordFrameIn(uint8 Code, SIZE_T Size)
+{
+	FramesIn.fetch_add(1, std::memory_order_relaxed);
+	BytesIn.fetch_add(Size, std::memory_order_relaxed);
+	ProtocolCounts[Code].fetch_add(1, std::memory_order_relaxed);
+}
+
+void RoomStats::RecordFrameOut(SIZE_T Size)
+{
+	FramesOut.fetch_add(1, std::memory_order_relaxed);
+	BytesOut.fetch_add(Size, std::memory_order_relaxed);
+}
+
+void RoomStats::RecordMessageType(const FString& Type)
+{
+	{
+		FReadScopeLock ReadLock(MessageTypeLock);
+		if (const TUniquePtr<std::atomic<uint64>>* Counter = MessageTypeCounts.Find(Type))
+		{
+			(*Counter)->fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	// First message of this type: take the write lock once to add its counter.
+	FWriteScopeLock WriteLock(MessageTypeLock);
+	TUniquePtr<std::atomic<uint64>>& Counter = MessageTypeCounts.FindOrAdd(Type);
+	if (!Counter.IsValid())
+	{
+		Counter = MakeUnique<std::atomic<uint64>>(0);
+	}
+	Counter->fetch_add(1, std::memory_order_relaxed);
+}
+
+void RoomStats::RecordPatch(SIZE_T Size)
+{
+	PatchBytes.Record(Size);
+}
+
+void RoomStats::RecordDecode(uint64 StartCycles)
+{
+	const uint64 Micros = CyclesToMicros(FPlatformTime::Cycles64() - StartCycles);
+	DecodeMicros.Record(Micros);
+	DecodeMicrosTotal.fetch_add(Micros, std::memory_order_relaxed);
+}
+
+void RoomStats::RecordDispatch(uint64 StartCycles)
+{
+	const uint64 Micros = CyclesToMicros(FPlatformTime::Cycles64() - StartCycles);
+	DispatchMicros.Record(Micros);
+	DispatchMicrosTotal.fetch_add(Micros, std::memory_order_relaxed);
+}
+
+RoomStatsSnapshot RoomStats::Snapshot() const
+{
+	RoomStatsSnapshot Result;
+	Result.BytesIn = BytesIn.load(std::memory_order_relaxed);
+	Result.BytesOut = BytesOut.load(std::memory_order_relaxed);
+	Result.FramesIn = FramesIn.load(std::memory_order_relaxed);
+	Result.FramesOut = FramesOut.load(std::memory_order_relaxed);
+
+	for (int32 Code = 0; Code < 256; Code++)
+	{
+		const uint64 Count = ProtocolCounts[Code].load(std::memory_order_relaxed);
+		if (Count > 0)
+		{
+			Result.ProtocolCounts.Add((uint8) Code, Count);
+		}
+	}
+
+	{
+		FReadScopeLock ReadLock(MessageTypeLock);
+		for (const TPair<FString, TUniquePtr<std::atomic<uint64>>>& Pair : MessageTypeCounts)
+		{
+			Result.MessageTypeCounts.Add(Pair.Key, Pair.Value->load(std::memory_order_relaxed));
+		}
+	}
+
+	Result.PatchCount = PatchBytes.GetCount();
+	Result.PatchBytesP50 = PatchBytes.GetPercentile(0.5);
+	Result.PatchBytesP99 = PatchBytes.GetPercentile(0.99);
+	Result.PatchBytesMax = PatchBytes.GetMax();
+
+	Result.DecodeMicrosP50 = DecodeMicros.GetPercentile(0.5);
+	Result.DecodeMicrosP99 = DecodeMicros.GetPercentile(0.99);
+	Result.DispatchMicrosP50 = DispatchMicros.GetPercentile(0.5);
+	Result.DispatchMicrosP99 = DispatchMicros.GetPercentile(0.99);
+	Result.DecodeMicrosTotal = DecodeMicrosTotal.load(std::memory_order_relaxed);
+	Result.DispatchMicrosTotal = DispatchMicrosTotal.load(std::memory_order_relaxed);
+
+	return Result;
+}
+
+void RoomStats::Reset()
+{
+	BytesIn.store(0, std::memory_order_relaxed);
+	BytesOut.store(0, std::memory_order_relaxed);
+	FramesIn.store(0, std::memory_order_relaxed);
+	FramesOut.store(0, std::memory_order_relaxed);
+	for (std::atomic<uint64>& Count : ProtocolCounts)
+	{
+		Count.store(0, std::memory_order_relaxed);
+	}
+
+	{
+		FWriteScopeLock WriteLock(MessageTypeLock);
+		MessageTypeCounts.Empty();
+	}
+
+	PatchBytes.Reset();
+	DecodeMicros.Reset();
+	DispatchMicros.Reset();
+	DecodeMicrosTotal.store(0, std::memory_order_relaxed);
+	DispatchMicrosTotal.store(0, std::memory_order_relaxed);
+}
+
+uint64 RoomStats::CyclesToMicros(uint64 Cycles)
+{
+	return (uint64) (FPlatformTime::ToSeconds64(Cycles) * 1000000.0);
+}
@@ -0,0 +1,127 @@
+#include "SendQueue.h"
+
+#include "ColyseusUtils.h"
+
+#include <HAL/PlatformTime.h>
+
+SendQueue::SendQueue(const SendQueueSettings& Settings)
+	: Settings(Settings)
+	, Tokens(Settings.MaxBytesPerSecond * 0.1)
+	, LastRefillTime(FPlatformTime::Seconds())
+{
+}
+
+void SendQueue::Enqueue(const void* Data, SIZE_T Size, uint32 CoalesceKey, bool bCanDrop)
+{
+	const uint64 Now = FPlatformTime::Cycles64();
+
+	if (CoalesceKey != 0)
+	{
+		for (Frame& Queued : Frames)
+		{
+			if (Queued.CoalesceKey == CoalesceKey)
+			{
+				// Keep the slot (and its place in line), replace the payload with the latest one.
+				QueuedBytes += (int64) Size - Queued.Bytes.Num();
+				Queued.Bytes.Reset();
+				Queued.Bytes.Append(static_cast<const uint8*>(Data), Size);
+				Queued.EnqueuedCycles = Now;
+				CoalescedFrames++;
+				return;
+			}
+		}
+	}
+
+	if (bCanDrop && QueuedBytes + (int64) Size > Settings.MaxQueuedBytes)
+	{
+		if (Settings.OverflowPolicy == ESendOverflowPolicy::DropNewest)
+		{
+			DroppedFrames++;
+			return;
+		}
+
+		Evict(QueuedBytes + Size - Settings.MaxQueuedBytes);
+	}
+
+	Frame& Queued = Frames.AddDefaulted_GetRef();
+	Queued.Bytes.Append(static_cast<const uint8*>(Data), Size);
+	Queued.CoalesceKey = CoalesceKey;
+	Queued.bCanDrop = bCanDrop;
+	Queued.EnqueuedCycles = Now;
+	QueuedBytes += Size;
+}
+
+int32 SendQueue::Flush(const TFunction<void(const void* Data, SIZE_T Size)>& Writer, int64 MaxBytes)
+{
+	const double Now = FPlatformTime::Seconds();
+	const bool bPaced = Settings.MaxBytesPerSecond > 0;
+
+	if (bPaced)
+	{
+		// Allow bursts of up to 100ms worth of budget.
+		const double Burst = Settings.MaxBytesPerSecond * 0.1;
+		Tokens = FMath::Min(Burst, Tokens + (Now - LastRefillTime) * Settings.MaxBytesPerSecond);
+	}
+	LastRefillTime = Now;
+
+	int32 Written = 0;
+	for (; Written < Frames.Num(); Written++)
+	{
+		Frame& Queued = Frames[Written];
+
+		// A frame larger than the burst still goes out once the bucket is full.
+		if (bPaced && Tokens < Queued.Bytes.Num() && Tokens < Settings.MaxBytesPerSecond * 0.1)
+		{
+			break;
+		}
+		// Likewise, a frame larger than the transport allowance still goes out once the transport is drained.
+		const bool bTransportDrained = Settings.MaxTransportBufferedBytes > 0 && MaxBytes >= Settings.MaxTransportBufferedBytes;
+		if (Queued.Bytes.Num() > MaxBytes && (Written > 0 || !bTransportDrained))
+		{
+			break;
+		}
+		MaxBytes -= Queued.Bytes.Num();
+
+		Writer(Queued.Bytes.GetData(), Queued.Bytes.Num());
+		SendLatencyMicros.Record(RoomStats::CyclesToMicros(FPlatformTime::Cycles64() - Queued.EnqueuedCycles));
+
+		Tokens -= Queued.Bytes.Num();
+		QueuedBytes -= Queued.Bytes.Num();
+	}
+
+	if (Written > 0)
+	{
+		Frames.RemoveAt(0, Written, COLYSEUS_NO_SHRINK);
+	}
+	return Written;
+}
+
+SendQueueStats SendQueue::GetStats() const
+{
+	SendQueueStats Stats;
+	Stats.QueuedBytes = QueuedBytes;
+	Stats.QueuedFrames = Frames.Num();
+	Stats.DroppedFrames = DroppedFrames;
+	Stats.CoalescedFrames = CoalescedFrames;
+	Stats.SendLatencyMicrosP50 = SendLatencyMicros.GetPercentile(0.5);
+	Stats.SendLatencyMicrosP99 = SendLatencyMicros.GetPercentile(0.99);
+	return Stats;
+}
+
+void SendQueue::Evict(int64 BytesNeeded)
+{
+	int64 Freed = 0;
+	for (int32 Index = 0; Index < Frames.Num() && Freed < BytesNeeded;)
+	{
+		if (!Frames[Index].bCanDrop)
+		{
+			Index++;
+			continue;
+		}
+
+		Freed += Frames[Index].Bytes.Num();
+		QueuedBytes -= Frames[Index].Bytes.Num();
+		Frames.RemoveAt(Index, 1, COLYSEUS_NO_SHRINK);
+		DroppedFrames++;
+	}
+}
@@ -0,0 +1,628 @@
+#include "SocketTransport.h"
+
+#include "ColyseusUtils.h"
+
+#include <Async/Async.h>
+#include <HAL/PlatformMisc.h>
+#include <HAL/PlatformProcess.h>
+#include <HAL/RunnableThread.h>
+#include <IPAddress.h>
+#include <Misc/Base64.h>
+#include <Misc/Guid.h>
+#include <Misc/ScopeLock.h>
+#include <Misc/SecureHash.h>
+#include <SocketSubsystem.h>
+#include <Sockets.h>
+
+namespace
+{
+const char* WebSocketGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+const int32 ReadBufferSize = 64 * 1024;
+const int32 MaxHandshakeSize = 8 * 1024;
+
+enum Opcode : uint8
+{
+	Continuation = 0x0,
+	Text = 0x1,
+	Binary = 0x2,
+	CloseFrame = 0x8,
+	Ping = 0x9,
+	Pong = 0xa,
+};
+
+// The handshake key and frame masks must not be predictable (RFC 6455, section 10.3).
+void FillRandom(uint8* Out, int32 Size)
+{
+	while (Size > 0)
+	{
+		FGuid Guid;
+		FPlatformMisc::CreateGuid(Guid);
+		const int32 Chunk = FMath::Min<int32>(Size, sizeof(Guid));
+		FMemory::Memcpy(Out, &Guid, Chunk);
+		Out += Chunk;
+		Size -= Chunk;
+	}
+}
+}	 // namespace
+
+SocketTransport::~SocketTransport()
+{
+	if (Thread)
+	{
+		// Kill() calls Stop() and waits for Run() to return.
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+	StopWriter();
+
+	if (Socket)
+	{
+		Socket->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+		Socket = nullptr;
+	}
+
+	if (WriteEvent)
+	{
+		FPlatformProcess::ReturnSynchEventToPool(WriteEvent);
+		WriteEvent = nullptr;
+	}
+}
+
+void SocketTransport::Connect(const FString& Url)
+{
+	if (!ParseUrl(Url))
+	{
+		Fail(FString::Printf(TEXT("SocketTransport => unsupported url %s (only ws:// is supported)"), *Url));
+		return;
+	}
+
+	WriteEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	Thread = FRunnableThread::Create(this, TEXT("ColyseusSocketTransport"), 0, TPri_Normal);
+}
+
+void SocketTransport::Send(const void* Data, SIZE_T Size)
+{
+	if (bOpen)
+	{
+		SendFrame(Binary, Data, Size);
+	}
+}
+
+void SocketTransport::Close(int32 Code, const FString& Reason)
+{
+	if (!bOpen)
+	{
+		Stop();
+		return;
+	}
+
+	// The server answers with its own close frame, which ends the read loop and fires OnClosed.
+	FTCHARToUTF8 ReasonBytes(*Reason);
+	TArray<uint8> Payload;
+	Payload.Add((uint8) (Code >> 8));
+	Payload.Add((uint8) (Code & 0xff));
+	Payload.Append(reinterpret_cast<const uint8*>(ReasonBytes.Get()), FMath::Min(ReasonBytes.Length(), 123));
+	SendFrame(CloseFrame, Payload.GetData(), Payload.Num());
+}
+
+int64 SocketTransport::GetBufferedAmount() const
+{
+	return BufferedBytes.load(std::memory_order_relaxed);
+}
+
+void SocketTransport::Detach()
+{
+	if (bOpen)
+	{
+		Close(1000, FString());
+	}
+
+	// Give the writer a moment to put the close frame on the wire before Stop() shuts the socket down.
+	bWriterStopping = true;
+	if (WriteEvent)
+	{
+		WriteEvent->Trigger();
+	}
+	if (Writer.IsValid())
+	{
+		Writer.WaitFor(FTimespan::FromMilliseconds(500));
+	}
+
+	// Join the transport threads before dropping the callbacks they may be calling.
+	if (Thread)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+	StopWriter();
+
+	OnConnected = nullptr;
+	OnConnectionError = nullptr;
+	OnRawMessage = nullptr;
+	OnClosed = nullptr;
+}
+
+uint32 SocketTransport::Run()
+{
+	// Stop() may have run while the connect was blocking.
+	if (!OpenSocket() || bStopping || !Handshake())
+	{
+		return 0;
+	}
+
+	Writer = Async(EAsyncExecution::Thread, [this]() { WriteFrames(); });
+
+	bOpen = true;
+	if (!bStopping && OnConnected)
+	{
+		OnConnected();
+	}
+
+	if (!ReadFrames())
+	{
+		bOpen = false;
+		if (!bStopping && OnClosed)
+		{
+			OnClosed(1006, TEXT("Connection lost"), false);
+		}
+	}
+
+	return 0;
+}
+
+void SocketTransport::Stop()
+{
+	bStopping = true;
+	bOpen = false;
+
+	// The writer still sends what is queued, unless the shutdown below makes that fail.
+	bWriterStopping = true;
+	if (WriteEvent)
+	{
+		WriteEvent->Trigger();
+	}
+
+	// Unblocks a pending Recv() on the transport thread. OpenSocket() checks bStopping under the same
+	// lock, so a socket it publishes after this point is never used.
+	FScopeLock ScopeLock(&SocketLock);
+	if (Socket)
+	{
+		Socket->Shutdown(ESocketShutdownMode::ReadWrite);
+	}
+}
+
+bool SocketTransport::ParseUrl(const FString& Url)
+{
+	FString Rest;
+	if (!Url.StartsWith(TEXT("ws://")))
+	{
+		return false;
+	}
+	Rest = Url.RightChop(5);
+
+	int32 PathStart = INDEX_NONE;
+	if (!Rest.FindChar(TEXT('/'), PathStart))
+	{
+		Rest.FindChar(TEXT('?'), PathStart);
+	}
+
+	FString Authority = PathStart == INDEX_NONE ? Rest : Rest.Left(PathStart);
+	Resource = PathStart == INDEX_NONE ? TEXT("/") : Rest.RightChop(PathStart);
+	if (!Resource.StartsWith(TEXT("/")))
+	{
+		Resource = TEXT("/") + Resource;
+	}
+
+	FString PortString;
+	if (Authority.Split(TEXT(":"), &Host, &PortString, ESearchCase::CaseSensitive, ESearchDir::FromEnd))
+	{
+		Port = FCString::Atoi(*PortString);
+	}
+	else
+	{
+		Host = Authority;
+		Port = 80;
+	}
+
+	return !Host.IsEmpty() && Port > 0;
+}
+
+bool SocketTransport::OpenSocket()
+{
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+
+	FAddressInfoResult Resolved = SocketSubsystem->GetAddressInfo(
+		*Host, *FString::FromInt(Port), EAddressInfoFlags::Default, NAME_None, ESocketType::SOCKTYPE_Streaming);
+	if (Resolved.ReturnCode != SE_NO_ERROR || Resolved.Results.Num() == 0)
+	{
+		Fail(FString::Printf(TEXT("SocketTransport => could not resolve %s"), *Host));
+		return false;
+	}
+
+	const TSharedRef<FInternetAddr>& Address = Resolved.Results[0].Address;
+	FSocket* NewSocket = SocketSubsystem->CreateSocket(NAME_Stream, TEXT("Colyseus SocketTransport"), Address->GetProtocolType());
+	if (!NewSocket)
+	{
+		Fail(TEXT("SocketTransport => could not create socket"));
+		return false;
+	}
+
+	{
+		FScopeLock ScopeLock(&SocketLock);
+		if (bStopping)
+		{
+			SocketSubsystem->DestroySocket(NewSocket);
+			return false;
+		}
+		Socket = NewSocket;
+	}
+
+	Socket->SetNoDelay(true);
+	if (!Socket->Connect(*Address))
+	{
+		Fail(FString::Printf(TEXT("SocketTransport => could not connect to %s:%d"), *Host, Port));
+		return false;
+	}
+
+	ReadBuffer.SetNumUninitialized(ReadBufferSize);
+	return true;
+}
+
+bool SocketTransport::Handshake()
+{
+	uint8 Nonce[16];
+	FillRandom(Nonce, sizeof(Nonce));
+	const FString Key = FBase64::Encode(Nonce, sizeof(Nonce));
+
+	const FString Request = FString::Printf(TEXT("GET %s HTTP/1.1\r\n"
+												 "Host: %s:%d\r\n"
+												 "Upgrade: websocket\r\n"
+												 "Connection: Upgrade\r\n"
+												 "Sec-WebSocket-Key: %s\r\n"
+												 "Sec-WebSocket-Version: 13\r\n\r\n"),
+		*Resource, *Host, Port, *Key);
+	FTCHARToUTF8 RequestBytes(*Request);
+	if (!WriteAll(reinterpret_cast<const uint8*>(RequestBytes.Get()), RequestBytes.Length()))
+	{
+		Fail(TEXT("SocketTransport => could not send handshake"));
+		return false;
+	}
+
+	// Read the response headers up to the blank line.
+	TArray<uint8> Response;
+	while (Response.Num() < 4 || FMemory::Memcmp(Response.GetData() + Response.Num() - 4, "\r\n\r\n", 4) != 0)
+	{
+		uint8 Byte;
+		if (Response.Num() >= MaxHandshakeSize || !ReadExact(&Byte, 1))
+		{
+			Fail(TEXT("SocketTransport => invalid handshake response"));
+			return false;
+		}
+		Response.Add(Byte);
+	}
+
+	Response.Add(0);
+	const FString Headers(UTF8_TO_TCHAR(reinterpret_cast<const ANSICHAR*>(Response.GetData())));
+	if (!Headers.StartsWith(TEXT("HTTP/1.1 101")))
+	{
+		Fail(FString::Printf(TEXT("SocketTransport => upgrade rejected: %s"), *Headers.Left(Headers.Find(TEXT("\r\n")))));
+		return false;
+	}
+
+	FTCHARToUTF8 AcceptSource(*(Key + WebSocketGuid));
+	uint8 Digest[20];
+	FSHA1::HashBuffer(AcceptSource.Get(), AcceptSource.Length(), Digest);
+	const FString ExpectedAccept = FBase64::Encode(Digest, sizeof(Digest));
+
+	TArray<FString> Lines;
+	Headers.ParseIntoArrayLines(Lines);
+	for (const FString& Line : Lines)
+	{
+		FString Name, Value;
+		if (Line.Split(TEXT(":"), &Name, &Value) && Name.TrimStartAndEnd().Equals(TEXT("Sec-WebSocket-Accept"), ESearchCase::IgnoreCase))
+		{
+			if (Value.TrimStartAndEnd() == ExpectedAccept)
+			{
+				return true;
+			}
+			break;
+		}
+	}
+
+	Fail(TEXT("SocketTransport => handshake accept key mismatch"));
+	return false;
+}
+
+bool SocketTransport::ReadFrames()
+{
+	while (!bStopping)
+	{
+		uint8 Header[2];
+		if (!ReadExact(Header, 2))
+		{
+			return false;
+		}
+
+		const bool bFinal = (Header[0] & 0x80) != 0;
+		const uint8 FrameOpcode = Header[0] & 0x0f;
+		const bool bMasked = (Header[1] & 0x80) != 0;
+		uint64 Length = Header[1] & 0x7f;
+
+		if (Length >= 126)
+		{
+			uint8 Extended[8];
+			const int32 ExtendedSize = Length == 126 ? 2 : 8;
+			if (!ReadExact(Extended, ExtendedSize))
+			{
+				return false;
+			}
+
+			Length = 0;
+			for (int32 Index = 0; Index < ExtendedSize; Index++)
+			{
+				Length = (Length << 8) | Extended[Index];
+			}
+		}
+
+		if (Length > MaxFrameSize)
+		{
+			Fail(TEXT("SocketTransport => frame too large"));
+			return false;
+		}
+
+		uint8 Mask[4] = {0, 0, 0, 0};
+		if (bMasked && !ReadExact(Mask, 4))
+		{
+			return false;
+		}
+
+		FrameBuffer.SetNumUninitialized((int32) Length, COLYSEUS_NO_SHRINK);
+		if (!ReadExact(FrameBuffer.GetData(), Length))
+		{
+			return false;
+		}
+
+		if (bMasked)
+		{
+			for (uint64 Index = 0; Index < Length; Index++)
+			{
+				FrameBuffer[Index] ^= Mask[Index & 3];
+			}
+		}
+
+		switch (FrameOpcode)
+		{
+			case Continuation:
+			case Text:
+			case Binary:
+			{
+				// Only continuations may follow an unfinished message, and only after one (RFC 6455, section 5.4).
+				const bool bContinuation = FrameOpcode == Continuation;
+				if (bContinuation != bFragmented)
+				{
+					Fail(bContinuation ? TEXT("SocketTransport => continuation without a message")
+									   : TEXT("SocketTransport => new message before the previous one finished"));
+					return false;
+				}
+
+				// Fragmented messages are reassembled here, so OnRawMessage always gets whole messages.
+				if (bFinal && !bContinuation)
+				{
+					if (!bStopping && OnRawMessage)
+					{
+						OnRawMessage(FrameBuffer.GetData(), FrameBuffer.Num(), 0);
+					}
+					break;
+				}
+
+				if ((uint64) MessageBuffer.Num() + Length > MaxMessageSize)
+				{
+					Fail(TEXT("SocketTransport => message too large"));
+					return false;
+				}
+
+				MessageBuffer.Append(FrameBuffer);
+				bFragmented = !bFinal;
+				if (bFinal)
+				{
+					if (!bStopping && OnRawMessage)
+					{
+						OnRawMessage(MessageBuffer.GetData(), MessageBuffer.Num(), 0);
+					}
+					MessageBuffer.Reset();
+				}
+				break;
+			}
+			case CloseFrame:
+			{
+				const int32 Code = Length >= 2 ? (FrameBuffer[0] << 8) | FrameBuffer[1] : 1005;
+				FString Reason;
+				if (Length > 2)
+				{
+					FUTF8ToTCHAR ReasonChars(reinterpret_cast<const ANSICHAR*>(FrameBuffer.GetData() + 2), (int32) Length - 2);
+					Reason = FString(ReasonChars.Length(), ReasonChars.Get());
+				}
+
+				// Echo the close unless we sent ours first; SendFrame() checks that under SendLock.
+				SendFrame(CloseFrame, FrameBuffer.GetData(), FMath::Min<uint64>(Length, 2));
+
+				bOpen = false;
+				if (!bStopping && OnClosed)
+				{
+					OnClosed(Code, Reason, true);
+				}
+				return true;
+			}
+			case Ping:
+				SendFrame(Pong, FrameBuffer.GetData(), FrameBuffer.Num());
+				break;
+			default:
+				break;
+		}
+	}
+
+	return true;
+}
+
+bool SocketTransport::ReadExact(uint8* Out, int64 Size)
+{
+	while (Size > 0)
+	{
+		if (ReadOffset == ReadEnd)
+		{
+			int32 BytesRead = 0;
+			if (!Socket->Recv(ReadBuffer.GetData(), ReadBuffer.Num(), BytesRead) || BytesRead <= 0)
+			{
+				return false;
+			}
+			ReadOffset = 0;
+			ReadEnd = BytesRead;
+		}
+
+		const int32 Chunk = (int32) FMath::Min<int64>(Size, ReadEnd - ReadOffset);
+		FMemory::Memcpy(Out, ReadBuffer.GetData() + ReadOffset, Chunk);
+		Out += Chunk;
+		ReadOffset += Chunk;
+		Size -= Chunk;
+	}
+	return true;
+}
+
+bool SocketTransport::WriteAll(const uint8* Data, int64 Size)
+{
+	while (Size > 0)
+	{
+		int32 BytesSent = 0;
+		if (!Socket->Send(Data, (int32) FMath::Min<int64>(Size, MAX_int32), BytesSent) || BytesSent <= 0)
+		{
+			return false;
+		}
+		Data += BytesSent;
+		Size -= BytesSent;
+	}
+	return true;
+}
+
+void SocketTransport::SendFrame(uint8 FrameOpcode, const void* Data, SIZE_T Size)
+{
+	FScopeLock ScopeLock(&SendLock);
+
+	if (!Socket || bCloseSent)
+	{
+		return;
+	}
+
+	// Client frames are always masked (RFC 6455, section 5.3).
+	uint8 Header[14];
+	int32 HeaderSize = 2;
+	Header[0] = 0x80 | FrameOpcode;
+	if (Size < 126)
+	{
+		Header[1] = 0x80 | (uint8) Size;
+	}
+	else if (Size < 65536)
+	{
+		Header[1] = 0x80 | 126;
+		Header[2] = (uint8) (Size >> 8);
+		Header[3] = (uint8) (Size & 0xff);
+		HeaderSize = 4;
+	}
+	else
+	{
+		Header[1] = 0x80 | 127;
+		for (int32 Index = 0; Index < 8; Index++)
+		{
+			Header[2 + Index] = (uint8) (((uint64) Size >> (56 - 8 * Index)) & 0xff);
+		}
+		HeaderSize = 10;
+	}
+
+	uint8* Mask = Header + HeaderSize;
+	FillRandom(Mask, 4);
+	HeaderSize += 4;
+
+	const int32 FrameStart = SendBuffer.Num();
+	SendBuffer.AddUninitialized(HeaderSize + Size);
+	FMemory::Memcpy(SendBuffer.GetData() + FrameStart, Header, HeaderSize);
+
+	const uint8* Payload = static_cast<const uint8*>(Data);
+	uint8* Masked = SendBuffer.GetData() + FrameStart + HeaderSize;
+	for (SIZE_T Index = 0; Index < Size; Index++)
+	{
+		Masked[Index] = Payload[Index] ^ Mask[Index & 3];
+	}
+
+	if (FrameOpcode == CloseFrame)
+	{
+		bCloseSent = true;
+	}
+
+	BufferedBytes.fetch_add(HeaderSize + Size, std::memory_order_relaxed);
+	WriteEvent->Trigger();
+}
+
+void SocketTransport::WriteFrames()
+{
+	// Swapped with SendBuffer, so both keep their capacity and steady traffic does not allocate.
+	TArray<uint8> Writing;
+	while (true)
+	{
+		{
+			FScopeLock ScopeLock(&SendLock);
+			Swap(Writing, SendBuffer);
+		}
+
+		if (Writing.Num() == 0)
+		{
+			if (bWriterStopping)
+			{
+				return;
+			}
+			WriteEvent->Wait();
+			continue;
+		}
+
+		if (!WriteAll(Writing.GetData(), Writing.Num()))
+		{
+			// Nothing more can be sent; shutting the socket down makes the reader report the connection as lost.
+			{
+				FScopeLock ScopeLock(&SendLock);
+				bCloseSent = true;
+				SendBuffer.Reset();
+			}
+			BufferedBytes.store(0, std::memory_order_relaxed);
+
+			FScopeLock ScopeLock(&SocketLock);
+			Socket->Shutdown(ESocketShutdownMode::ReadWrite);
+			return;
+		}
+
+		BufferedBytes.fetch_sub(Writing.Num(), std::memory_order_relaxed);
+		Writing.Reset();
+	}
+}
+
+void SocketTransport::StopWriter()
+{
+	bWriterStopping = true;
+	if (WriteEvent)
+	{
+		WriteEvent->Trigger();
+	}
+	if (Writer.IsValid())
+	{
+		Writer.Wait();
+		Writer = TFuture<void>();
+	}
+}
+
+void SocketTransport::Fail(const FString& Error)
+{
+	if (!bStopping && OnConnectionError)
+	{
+		OnConnectionError(Error);
+	}
+}
@@ -0,0 +1,85 @@
+#include "WebSocketTransport.h"
+
+#include <WebSocketsModule.h>
+
+WebSocketTransport::~WebSocketTransport()
+{
+	if (Socket)
+	{
+		Socket->OnRawMessage().Clear();
+		Socket->OnClosed().Clear();
+		Socket->OnConnected().Clear();
+		Socket->OnConnectionError().Clear();
+		Socket->Close();
+		Socket = nullptr;
+	}
+}
+
+void WebSocketTransport::Connect(const FString& Url)
+{
+	EnsureModuleLoaded();
+
+	Socket = FWebSocketsModule::Get().CreateWebSocket(Url, "wss");
+
+	Socket->OnConnected().AddLambda(
+		[this]() -> void
+		{
+			if (this->OnConnected)
+			{
+				this->OnConnected();
+			}
+		});
+
+	Socket->OnConnectionError().AddLambda(
+		[this](const FString& message) -> void
+		{
+			if (this->OnConnectionError)
+			{
+				this->OnConnectionError(message);
+			}
+		});
+
+	Socket->OnRawMessage().AddLambda(
+		[this](const void* Data, SIZE_T Size, SIZE_T BytesRemaining) -> void
+		{
+			if (this->OnRawMessage)
+			{
+				this->OnRawMessage(Data, Size, BytesRemaining);
+			}
+		});
+
+	Socket->OnClosed().AddLambda(
+		[this](int32 StatusCode, const FString& Reason, bool bWasClean) -> void
+		{
+			if (this->OnClosed)
+			{
+				this->OnClosed(StatusCode, Reason, bWasClean);
+			}
+		});
+
+	Socket->Connect();
+}
+
+void WebSocketTransport::Send(const void* Data, SIZE_T Size)
+{
+	if (Socket)
+	{
+		Socket->Send(Data, Size, true);
+	}
+}
+
+void WebSocketTransport::Close(int32 Code, const FString& Reason)
+{
+	if (Socket)
+	{
+		Socket->Close(Code, Reason);
+	}
+}
+
+void WebSocketTransport::EnsureModuleLoaded()
+{
+	if (!FModuleManager::Get().IsModuleLoaded("WebSockets"))
+	{
+		FModuleManager::Get().LoadModule("WebSockets");
+	}
+}
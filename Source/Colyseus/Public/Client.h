@@ -1,11 +1,23 @@
 #pragma once
 
+#include "ClientWarmUp.h"
+
 #include "ColyseusUtils.h"
 
+#include "MatchMakeHttp.h"
+
+#include "MatchMakeResponse.h"
+
 #include "Connection.h"
 
+#include "JoinTrace.h"
+
 #include "Room.h"
 
+#include "RoomListing.h"
+
+#include "WebSocketTransport.h"
+
 #include <Containers/UnrealString.h>
 
 #include <Http.h>
@@ -23,16 +35,55 @@ class MatchMakeError {
   FString Message;
 };
 
+template < typename S >
+  struct BatchJoinResult {
+    FString RoomId;
+    // Set when the join failed; code 408 when the batch deadline passed first
+    TSharedPtr < MatchMakeError > Error;
+    TSharedPtr < Room < S >> RoomInstance;
+  };
+
 class Client {
   public: FString Endpoint;
 
+  // Transport for the rooms this client joins; the engine WebSocket is used when unset.
+  TransportFactory CreateTransport;
+
+  // Matchmaking requests; HttpClient -> EnableLoopbackStandIn() answers them in process. Callbacks that
+  // use the client check this is still alive, so keep it owned by the client alone.
+  TSharedRef < MatchMakeHttp > HttpClient = MakeShared < MatchMakeHttp > ();
+
+  // Room lists from GetAvailableRooms(), shared by every caller of this client.
+  TSharedRef < RoomListingCache > RoomLists = MakeShared < RoomListingCache > ();
+
+  // Seconds a room list is served from the cache before GetAvailableRooms() asks the server again.
+  double RoomListMaxAge = 2.0;
+
+  // Called with the phase timestamps of each successful join, once its first state has been handled.
+  TFunction < void(const JoinTrace & ) > OnJoinTrace;
+
+  // Same as OnJoinTrace, summarised into module load, matchmake and connect times.
+  TFunction < void(const JoinTimings & ) > OnJoinTimings;
+
+  // Per-phase histograms of every traced join, e.g. for live-ops dashboards.
+  TSharedRef < JoinTraceStats > JoinStats = MakeShared < JoinTraceStats > ();
+
   Client(const FString & Endpoint): Endpoint(Endpoint) {}
 
+  // Loads the WebSockets module, resolves the server's host and opens an HTTP connection before the
+  // first join needs them. Call it early, e.g. while the menu loads. Must run on the game thread.
+  inline void WarmUp(const TFunction < void(const WarmUpTimings & ) > & OnComplete = nullptr) {
+    ClientWarmUp::Run(GetHttpEndpoint(), !CreateTransport, OnComplete);
+  }
+
+  // IntoRoom, when set, is the room that connects and is passed to Callback. Callers that pump rooms
+  // themselves (Room::Tick()) can then tick it before it has joined.
   template < typename S >
   inline void JoinOrCreate(const FString & RoomName,
     const JoinOptions & Options,
-      const TFunction < void(TSharedPtr < MatchMakeError > , TSharedPtr < Room < S >> ) > & Callback) {
-    CreateMatchMakeRequest < S > ("joinOrCreate", RoomName, Options, Callback);
+      const TFunction < void(TSharedPtr < MatchMakeError > , TSharedPtr < Room < S >> ) > & Callback,
+        TSharedPtr < Room < S >> IntoRoom = nullptr) {
+    CreateMatchMakeRequest < S > ("joinOrCreate", RoomName, Options, Callback, IntoRoom);
   }
 
   template < typename S >
@@ -68,64 +119,193 @@ class Client {
     }, Callback);
   }
 
-  private: template < typename S >
+  // Joins every room in RoomIds with at most MaxConcurrent joins (matchmake request and connect) running at once.
+  // Callback runs once, with one result per id in the same order, when all joins finished or TimeoutSeconds
+  // passed; joins still running then fail with code 408, and rooms they join afterwards are left. Destroying
+  // the client stops the batch: no further joins start, and Callback may never run.
+  template < typename S >
+  void JoinByIds(const TArray < FString > & RoomIds,
+    const JoinOptions & Options,
+      int32 MaxConcurrent,
+        double TimeoutSeconds,
+          const TFunction < void(const TArray < BatchJoinResult < S >> & ) > & Callback) {
+    struct BatchState {
+      TArray < BatchJoinResult < S >> Results;
+      TArray < bool > Finished;
+      int32 NextIndex = 0;
+      int32 InFlight = 0;
+      int32 Completed = 0;
+      bool bDone = false;
+      ColyseusTimerHandle Deadline;
+      TFunction < void(const TArray < BatchJoinResult < S >> & ) > Callback;
+      TFunction < void() > StartNext;
+    };
+
+    TSharedRef < BatchState > State = MakeShared < BatchState > ();
+    State -> Results.SetNum(RoomIds.Num());
+    State -> Finished.Init(false, RoomIds.Num());
+    State -> Callback = Callback;
+    for (int32 Index = 0; Index < RoomIds.Num(); Index++) {
+      State -> Results[Index].RoomId = RoomIds[Index];
+    }
+
+    auto Finish = [](const TSharedRef < BatchState > & Batch) {
+      Batch -> bDone = true;
+      ClearColyseusTimeout(Batch -> Deadline);
+      Batch -> Callback(Batch -> Results);
+    };
+
+    // Joins finish from HTTP and room callbacks that can outlive this client. HttpClient is owned by
+    // the client, so once it has expired the client is gone and no further joins are started.
+    TWeakPtr < BatchState > WeakState = State;
+    TWeakPtr < MatchMakeHttp > WeakHttp = HttpClient;
+    State -> StartNext = [this, WeakState, WeakHttp, Options, MaxConcurrent, Finish]() {
+      TSharedPtr < BatchState > Batch = WeakState.Pin();
+      while (Batch.IsValid() && WeakHttp.IsValid() && !Batch -> bDone && Batch -> InFlight < FMath::Max(1, MaxConcurrent) && Batch -> NextIndex < Batch -> Results.Num()) {
+        const int32 Index = Batch -> NextIndex++;
+        Batch -> InFlight++;
+
+        TSharedRef < BatchState > Held = Batch.ToSharedRef();
+        JoinById < S > (Batch -> Results[Index].RoomId, Options,
+          [Held, Index, Finish](TSharedPtr < MatchMakeError > Error, TSharedPtr < Room < S >> Joined) {
+            if (Held -> bDone) {
+              // Joined after the deadline; nobody is waiting for this room.
+              if (Joined.IsValid()) {
+                Joined -> Leave(true);
+              }
+              return;
+            }
+
+            Held -> Results[Index].Error = Error;
+            Held -> Results[Index].RoomInstance = Joined;
+            Held -> Finished[Index] = true;
+            Held -> InFlight--;
+
+            if (++Held -> Completed == Held -> Results.Num()) {
+              Finish(Held);
+            } else if (Held -> StartNext) {
+              Held -> StartNext();
+            }
+          });
+      }
+    };
+
+    if (RoomIds.Num() == 0) {
+      Finish(State);
+      return;
+    }
+
+    if (TimeoutSeconds > 0.0) {
+      State -> Deadline = SetColyseusTimeout((float) TimeoutSeconds, [WeakState, Finish]() {
+        TSharedPtr < BatchState > Batch = WeakState.Pin();
+        if (!Batch.IsValid() || Batch -> bDone) {
+          return;
+        }
+        for (int32 Index = 0; Index < Batch -> Results.Num(); Index++) {
+          if (!Batch -> Finished[Index]) {
+            Batch -> Results[Index].Error = MakeShared < MatchMakeError > (408, TEXT("Timed out"));
+          }
+        }
+        Finish(Batch.ToSharedRef());
+      });
+    }
+
+    State -> StartNext();
+  }
+
+  // Lists the rooms named RoomName that can be joined. Lists younger than MaxAge (RoomListMaxAge by default)
+  // come from the cache, and concurrent calls share one request. Callback may run before this returns.
+  inline void GetAvailableRooms(const FString & RoomName,
+    const TFunction < void(TSharedPtr < MatchMakeError > , const TArray < RoomListing > & ) > & Callback) {
+    GetAvailableRooms(RoomName, RoomListMaxAge, Callback);
+  }
+
+  inline void GetAvailableRooms(const FString & RoomName, double MaxAge,
+    const TFunction < void(TSharedPtr < MatchMakeError > , const TArray < RoomListing > & ) > & Callback) {
+    RoomLists -> Get(HttpClient.Get(), GetHttpEndpoint() + "/matchmake/" + RoomName, RoomName, MaxAge,
+      [Callback](const RoomListingResult & Result) {
+        if (!Result.bSuccess) {
+          TSharedPtr < MatchMakeError > Error(new MatchMakeError(Result.ErrorCode, Result.ErrorMessage));
+          Callback(Error, Result.Rooms);
+          return;
+        }
+        Callback(nullptr, Result.Rooms);
+      });
+  }
+
+  // Rejoins with an existing room instance, keeping its decoded state: the server's full state is
+  // reconciled into it, so only the entities that changed while disconnected fire callbacks.
+  // The room's OnJoin and OnError are taken over for the rejoin, as with a fresh join.
+  template < typename S >
+  inline void Reconnect(TSharedPtr < Room < S >> ExistingRoom,
+    const TFunction < void(TSharedPtr < MatchMakeError > , TSharedPtr < Room < S >> ) > & Callback) {
+    CreateMatchMakeRequest < S > ("joinById", ExistingRoom -> Id, {
+      {
+        "sessionId",
+        ExistingRoom -> SessionId
+      }
+    }, Callback, ExistingRoom);
+  }
+
+  private: inline FString GetHttpEndpoint() const {
+    // Only the scheme changes (ws -> http, wss -> https); a host or path containing "ws" is left alone.
+    return Endpoint.StartsWith(TEXT("ws")) ? TEXT("http") + Endpoint.Mid(2) : Endpoint;
+  }
+
+  template < typename S >
     void CreateMatchMakeRequest(const FString & Method,
       const FString & RoomName,
         const JoinOptions & Options,
-          TFunction < void(TSharedPtr < MatchMakeError > , TSharedPtr < Room < S >> ) > Callback) {
-      FHttpModule * HttpModule = & FHttpModule::Get();
-      TSharedRef < IHttpRequest, ESPMode::ThreadSafe > HttpRequest = HttpModule -> CreateRequest();
-
-      HttpRequest -> SetURL(this -> Endpoint.Replace(TEXT("ws"), TEXT("http")) + "/matchmake/" + Method + "/" + RoomName);
-      HttpRequest -> SetVerb("POST");
+          TFunction < void(TSharedPtr < MatchMakeError > , TSharedPtr < Room < S >> ) > Callback,
+            TSharedPtr < Room < S >> ExistingRoom = nullptr) {
+      MatchMakeHttp::RequestRef HttpRequest = HttpClient -> CreateRequest("POST", GetHttpEndpoint() + "/matchmake/" + Method + "/" + RoomName);
 
-      FString Body = StdStringToFString(Options.dump());
-      if (Body == "null") {
-        Body = "{}";
-      }
-      HttpRequest -> SetContentAsString(Body);
+      // dump() already produces UTF-8, so it goes into the payload as-is, without an FString round trip.
+      const std::string Body = Options.is_null() ? std::string("{}") : Options.dump();
+      TArray < uint8 > Payload(reinterpret_cast < const uint8 * > (Body.data()), (int32) Body.size());
+      HttpRequest -> SetContent(MoveTemp(Payload));
 
-      HttpRequest -> SetHeader("Accept", "application/json");
       HttpRequest -> SetHeader("Content-Type", "application/json");
 
-      HttpRequest -> OnProcessRequestComplete().BindLambda(
-        [this, RoomName, Callback](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful) {
-          if (!bWasSuccessful || !Response.IsValid()) {
+      TSharedRef < JoinTrace > Trace = MakeShared < JoinTrace > ();
+
+      HttpClient -> Enqueue(HttpRequest,
+        [this, RoomName, Callback, ExistingRoom, Trace](const MatchMakeHttpResponse & Response, bool bWasSuccessful) {
+          Trace -> Mark(EJoinPhase::ResponseReceived);
+
+          if (!bWasSuccessful) {
             TSharedPtr < MatchMakeError > Error(new MatchMakeError(0, "HttpRequest => no/invalid response"));
             Callback(Error, nullptr);
             return;
           }
 
-          if (!EHttpResponseCodes::IsOk(Response -> GetResponseCode())) {
-            TSharedPtr < MatchMakeError > Error(new MatchMakeError((int) Response -> GetResponseCode(), TEXT("Server Error")));
+          if (!EHttpResponseCodes::IsOk(Response.Code)) {
+            TSharedPtr < MatchMakeError > Error(new MatchMakeError((int) Response.Code, TEXT("Server Error")));
             Callback(Error, nullptr);
             return;
           }
 
-          FString Data = Response -> GetContentAsString();
-          nlohmann::json json;
-          try {
-            json = nlohmann::json::parse(FStringToStdString(Data));
-          } catch (const std::exception & e) {
-            TSharedPtr < MatchMakeError > Error(new MatchMakeError(0, FString::Printf(TEXT("JSON parse error: %s"), UTF8_TO_TCHAR(e.what()))));
+          const TArray < uint8 > & Content = Response.Content;
+          MatchMakeResponse Parsed;
+          std::string ParseError;
+          if (!Parsed.Parse(Content.GetData(), Content.Num(), ParseError)) {
+            TSharedPtr < MatchMakeError > Error(new MatchMakeError(0, FString::Printf(TEXT("Invalid matchmake response: %s"), UTF8_TO_TCHAR(ParseError.c_str()))));
             Callback(Error, nullptr);
             return;
           }
           // Server responded with error.
-          if (json["error"].is_string()) {
-            int Code = json["code"].get < int > ();
-            FString Message = StdStringToFString(json["error"].get < std::string > ());
-
-            TSharedPtr < MatchMakeError > Error(new MatchMakeError(Code, Message));
+          if (Parsed.bHasError) {
+            TSharedPtr < MatchMakeError > Error(new MatchMakeError(Parsed.Code, StdStringToFString(Parsed.Error)));
             Callback(Error, nullptr);
             return;
           }
 
-          TSharedPtr < Room < S >> RoomInstance(new Room < S > (RoomName));
-          RoomInstance -> Id = StdStringToFString(json["room"]["roomId"].get < std::string > ());
-          RoomInstance -> SessionId = StdStringToFString(json["sessionId"].get < std::string > ());
+          TSharedPtr < Room < S >> RoomInstance = ExistingRoom.IsValid() ? ExistingRoom : TSharedPtr < Room < S >> (new Room < S > (RoomName));
+          RoomInstance -> CreateTransport = this -> CreateTransport;
+          RoomInstance -> Id = StdStringToFString(Parsed.RoomId);
+          RoomInstance -> SessionId = StdStringToFString(Parsed.SessionId);
 
-          FString ProcessId = StdStringToFString(json["room"]["processId"].get < std::string > ());
+          FString ProcessId = StdStringToFString(Parsed.ProcessId);
 
           RoomInstance -> OnError = [RoomInstance, Callback](const int & Code,
             const FString & Message) {
@@ -141,10 +321,33 @@ class Client {
             RoomInstance -> OnJoin = nullptr;
           };
 
+          // The room may outlive this client, so the callback holds its own references.
+          TSharedRef < JoinTraceStats > Stats = this -> JoinStats;
+          TFunction < void(const JoinTrace & ) > OnTrace = this -> OnJoinTrace;
+          TFunction < void(const JoinTimings & ) > OnTimings = this -> OnJoinTimings;
+          RoomInstance -> OnJoinTraced = [Stats, OnTrace, OnTimings](const JoinTrace & Completed) {
+            Stats -> Record(Completed);
+            if (OnTrace) {
+              OnTrace(Completed);
+            }
+            if (OnTimings) {
+              OnTimings(JoinTimings::FromTrace(Completed));
+            }
+          };
+
           RoomInstance -> Connect(
-            this -> Endpoint + "/" + ProcessId + "/" + RoomInstance -> Id + "?sessionId=" + RoomInstance -> SessionId);
+            this -> Endpoint + "/" + ProcessId + "/" + RoomInstance -> Id + "?sessionId=" + RoomInstance -> SessionId, * Trace);
+        },
+        // Stamped when the request leaves the queue, so waiting for a slot is not counted as matchmake time.
+        [Trace]() {
+          Trace -> Mark(EJoinPhase::RequestSent);
         });
 
-      HttpRequest -> ProcessRequest();
+      // The socket needs the WebSockets module only after the response; load it while the request is in flight.
+      if (!CreateTransport) {
+        const double ModuleStart = FPlatformTime::Seconds();
+        WebSocketTransport::EnsureModuleLoaded();
+        Trace -> ModuleLoadSeconds = FPlatformTime::Seconds() - ModuleStart;
+      }
     }
 };
\ No newline at end of file
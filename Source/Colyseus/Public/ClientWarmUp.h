@@ -0,0 +1,30 @@
+#pragma once
+
+#include <CoreMinimal.h>
+
+struct COLYSEUSCLIENT_API WarmUpTimings
+{
+	// Seconds spent on each step; steps run concurrently, so they do not add up to the total
+	double ModuleLoadSeconds = 0.0;
+	double DnsSeconds = 0.0;
+	double PreconnectSeconds = 0.0;
+	double TotalSeconds = 0.0;
+
+	bool bDnsResolved = false;
+	bool bPreconnected = false;
+};
+
+/**
+ * Does the one-off work of a first join ahead of time: loads the WebSockets module, resolves the
+ * server's host name and opens an HTTP connection that the HTTP backend keeps for the matchmake
+ * request (libcurl keeps connections in a shared cache).
+ */
+class COLYSEUSCLIENT_API ClientWarmUp
+{
+public:
+	/**
+	 * Starts warming up for HttpEndpoint (the matchmaker's http(s):// base URL). Must run on the game
+	 * thread; OnComplete, if set, runs on the game thread once every step has finished.
+	 */
+	static void Run(const FString& HttpEndpoint, bool bLoadWebSockets, const TFunction<void(const WarmUpTimings&)>& OnComplete);
+};
@@ -1,8 +1,32 @@
 #pragma once
 
+#include <Containers/Ticker.h>
 #include <Containers/UnrealString.h>
+#include <Runtime/Launch/Resources/Version.h>
 
 #include <string>
 
 std::string COLYSEUSCLIENT_API FStringToStdString(const FString& UEString);
 FString COLYSEUSCLIENT_API StdStringToFString(const std::string& StdString);
+
+// Ticks the core ticker and HTTP manager by hand, for loops that run without the engine's tick (commandlets, tools).
+void COLYSEUSCLIENT_API TickColyseusCore(float DeltaSeconds);
+
+// Core ticker handles; UE5 moved the core ticker to the thread-safe FTSTicker.
+#if ENGINE_MAJOR_VERSION >= 5
+typedef FTSTicker::FDelegateHandle ColyseusTimerHandle;
+#else
+typedef FDelegateHandle ColyseusTimerHandle;
+#endif
+
+// Passed to TArray removals and resizes that should keep their allocation; UE 5.4 replaced the bool
+// argument with EAllowShrinking.
+#if ENGINE_MAJOR_VERSION > 5 || (ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 4)
+#define COLYSEUS_NO_SHRINK EAllowShrinking::No
+#else
+#define COLYSEUS_NO_SHRINK false
+#endif
+
+// Runs Callback once on the game thread after DelaySeconds, unless cleared first.
+ColyseusTimerHandle COLYSEUSCLIENT_API SetColyseusTimeout(float DelaySeconds, const TFunction<void()>& Callback);
+void COLYSEUSCLIENT_API ClearColyseusTimeout(const ColyseusTimerHandle& Handle);
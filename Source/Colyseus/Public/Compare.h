@@ -2,8 +2,11 @@
 
 #include <stdio.h>
 
+#include <deque>
 #include <iostream>
+#include <memory>
 #include <sstream>
+#include <unordered_map>
 
 
 THIRD_PARTY_INCLUDES_START
@@ -13,23 +16,147 @@ THIRD_PARTY_INCLUDES_START
 #pragma pop_macro("check")
 THIRD_PARTY_INCLUDES_END
 
+// One key of a patch path. Nodes link to their parent, so all patches below a map share its prefix.
+struct PathNode
+{
+	const PathNode* parent;
+	// The key's bytes inside the compared tree, or null for an array index, held in size
+	const char* data;
+	uint32_t size;
+};
+
+// Owns the path nodes of one getPatchList() call; its patches keep it alive.
+class PathArena
+{
+public:
+	const PathNode* push(const PathNode* parent, const msgpack::object& key);
+	const PathNode* push(const PathNode* parent, uint32_t index);
+
+	size_t size() const;
+	// Drops the nodes pushed after size() returned count.
+	void rewind(size_t count);
+
+private:
+	std::deque<PathNode> nodes;
+};
+
 class PatchObject
 {
 public:
-	PatchObject(std::vector<std::string> path, std::string op, msgpack::object value);
-	std::vector<std::string> path;
-	std::string op;	   // "add" | "remove" | "replace"
+	PatchObject(std::shared_ptr<const PathArena> arena, const PathNode* path, std::string op, msgpack::object value,
+		const PathNode* fromPath = nullptr);
+
+	// Keys (array indexes in decimal) from the root to the changed value. Like value, it reads from the
+	// compared trees, so call it while they are alive.
+	std::vector<std::string> getPath() const;
+	// Where a "move" takes its value from
+	std::vector<std::string> getFromPath() const;
+
+	std::string op;	   // "add" | "remove" | "replace" | "move"
 	msgpack::object value;
 	msgpack::object previousValue;
+
+private:
+	std::shared_ptr<const PathArena> arena;
+	const PathNode* path;
+	const PathNode* fromPath;
 };
 
+/**
+ * 64-bit hashes of msgpack maps and arrays, so Compare can skip subtrees that did not change without
+ * walking both. Hashes are cached by the address of a container's contents, which a freed zone hands
+ * out again, so each diff starts from empty tables unless advance() was called since the last one.
+ */
+class SubtreeFingerprints
+{
+public:
+	// True if both values are equal; containers are compared by hash.
+	bool same(const msgpack::object& oldValue, const msgpack::object& newValue);
+
+	void clear();
+
+	/**
+	 * Lets the next diff reuse the new tree's hashes from the last one as its old tree's. Call it only
+	 * when the next diff's old tree is that same tree, unchanged and still alive: keep its
+	 * msgpack::object_handle or zone until then, so no other tree can be unpacked at its addresses.
+	 */
+	void advance();
+
+	// Containers with fewer values below them are not cached.
+	static constexpr size_t MinCachedObjects = 32;
+
+private:
+	friend class Compare;
+	typedef std::unordered_map<const void*, uint64_t> HashTable;
+
+	void begin();
+	static uint64_t hash(const msgpack::object& value, HashTable& table, bool cache, size_t& objects);
+
+	// Hashes of the old tree and of the new one
+	HashTable previous;
+	HashTable current;
+	bool advanced = false;
+	// Set while parallel workers read the tables; nothing is added to them then.
+	bool frozen = false;
+};
+
+/**
+ * Diffs msgpack trees into patches. Maps are compared key by key. Arrays are aligned by their longest
+ * common subsequence, so an insertion or removal costs one patch. Elements that moved become "move"
+ * patches, and changed elements are diffed in place. Array patches are ordered so that applying them
+ * one after another, JSON Patch style, turns the old array into the new one.
+ */
 class Compare
 {
 public:
-	static msgpack::object_handle* emptyState;
+	// Bytes of a STR key, pointing into the unpacked object rather than copying them.
+	struct KeyView
+	{
+		const char* data;
+		uint32_t size;
+
+		bool operator==(const KeyView& other) const;
+	};
+
+	struct KeyViewHash
+	{
+		size_t operator()(const KeyView& key) const;
+	};
+
+	// Index of each string key of one map level, so lookups are O(1) instead of a scan per key.
+	typedef std::unordered_map<KeyView, uint32_t, KeyViewHash> KeyIndex;
+
+	// Arrays whose differing middle section needs a bigger alignment table (old x new elements) are
+	// compared index by index instead.
+	static size_t maxArrayDiffCells;
 
 	static bool containsKey(msgpack::object_map map, msgpack::object_kv key);
-	static std::vector<PatchObject> getPatchList(const msgpack::object tree1, const msgpack::object tree2);
+	static void buildKeyIndex(const msgpack::object_map& map, KeyIndex& index);
+	// With fingerprints set, unchanged maps and arrays are skipped by hash; see SubtreeFingerprints.
+	static std::vector<PatchObject> getPatchList(
+		const msgpack::object tree1, const msgpack::object tree2, SubtreeFingerprints* fingerprints = nullptr);
+
+	// Like getPatchList(), with the top-level keys split into runs of keysPerTask diffed on the task
+	// graph's workers. Patches come out in the same order. Meant for large states; small ones are diffed
+	// on the calling thread.
+	static std::vector<PatchObject> getPatchListParallel(const msgpack::object tree1, const msgpack::object tree2,
+		SubtreeFingerprints* fingerprints = nullptr, uint32_t keysPerTask = 16);
+
+	// A shared, immutable empty map, or empty array for type ARRAY, to diff additions against.
+	static const msgpack::object& emptyValue(msgpack::type::object_type type);
 	static void generate(const msgpack::object mirrorPacked, const msgpack::object objPacked, std::vector<PatchObject>* patches,
-		std::vector<std::string> path);
+		const std::shared_ptr<PathArena>& arena, const PathNode* path, SubtreeFingerprints* fingerprints = nullptr);
+
+private:
+	// Diffs one key of the old map; returns true if it was removed.
+	static bool generateEntry(const msgpack::object_kv& kv, const msgpack::object_map& obj, const KeyIndex& newKeys,
+		std::vector<PatchObject>* patches, const std::shared_ptr<PathArena>& arena, const PathNode* path,
+		SubtreeFingerprints* fingerprints);
+	static void generateAdditions(const msgpack::object_map& mirror, const msgpack::object_map& obj,
+		std::vector<PatchObject>* patches, const std::shared_ptr<PathArena>& arena, const PathNode* path);
+	static void generateArray(const msgpack::object& mirrorPacked, const msgpack::object& objPacked,
+		std::vector<PatchObject>* patches, const std::shared_ptr<PathArena>& arena, const PathNode* path,
+		SubtreeFingerprints* fingerprints);
+	static void generateValue(const msgpack::object& oldVal, const msgpack::object& newVal, std::vector<PatchObject>* patches,
+		const std::shared_ptr<PathArena>& arena, const PathNode* path, SubtreeFingerprints* fingerprints);
 };
@@ -1,6 +1,12 @@
 #pragma once
 
-#include <IWebSocket.h>
+#include "FrameBufferPool.h"
+#include "FrameQueue.h"
+#include "FrameRecorder.h"
+#include "RoomStats.h"
+#include "SendQueue.h"
+#include "Transport.h"
+
 #include <stdio.h>
 
 #include <functional>
@@ -8,26 +14,58 @@
 class COLYSEUSCLIENT_API Connection
 {
 private:
-	TSharedPtr<IWebSocket> Socket;
+	TSharedPtr<ITransport> Transport;
 
 public:
-	~Connection()
-	{
-		Socket->OnRawMessage().Clear();
-		Socket->OnClosed().Clear();
-		Socket->OnConnected().Clear();
-		Socket->OnConnectionError().Clear();
-		Socket->Close();
-		Socket = nullptr;
-	}
+	~Connection();
 
 	// Methods
 	void Connect(const FString& Url);
 	void Close(int32 Code = 1000, const FString& Reason = FString());
 
-	inline void Send(const void* Buffer, SIZE_T Size) const
+	/**
+	 * Sends a binary frame. With a send queue enabled, frames sharing a non-zero CoalesceKey replace
+	 * each other while queued, and only frames with bCanDrop set are dropped when the queue is full.
+	 */
+	void Send(const void* Buffer, SIZE_T Size, uint32 CoalesceKey = 0, bool bCanDrop = true);
+
+	/** Writes a frame to the transport right away, ahead of the send queue: never paced, coalesced or dropped. */
+	void SendImmediate(const void* Buffer, SIZE_T Size);
+
+	/** Buffers outbound frames and paces them according to Settings. Can be enabled at any time. */
+	void EnableSendQueue(const SendQueueSettings& Settings);
+
+	/** Writes whatever the send budget allows to the socket; returns how many frames were written. */
+	int32 FlushSendQueue();
+
+	SendQueueStats GetSendQueueStats() const;
+
+	/**
+	 * Routes socket events through a FrameQueue instead of invoking the callbacks from the socket's
+	 * delegates. Call before Connect(); the callbacks then only run from PumpEvents().
+	 *
+	 * The queue only isolates frame time from receive jitter when the transport receives on a thread
+	 * of its own, as SocketTransport does (it enables the queue itself). The engine WebSocket behind
+	 * the default WebSocketTransport fires its delegates from its game-thread tick, so with it the
+	 * queue only moves delivery to PumpEvents(), at the cost of up to a frame of latency.
+	 */
+	void EnableEventQueue(uint32 Capacity = 256);
+
+	/** Delivers queued events to the callbacks on the calling thread; returns how many were delivered. */
+	int32 PumpEvents(int32 MaxEvents = MAX_int32);
+
+	inline bool IsEventQueueEnabled() const
 	{
-		Socket->Send(Buffer, Size, true);
+		return Queue.IsValid();
+	}
+
+	/** While PumpEvents() runs OnMessage, seconds the message spent queued; 0 for messages delivered directly. */
+	double GetDispatchQueueSeconds() const;
+
+	// Time events spent in the queue before PumpEvents() delivered them, in microseconds
+	inline const Log2Histogram& GetQueueLatency() const
+	{
+		return QueueLatencyMicros;
 	}
 
 	// Callbacks
@@ -37,5 +75,25 @@ public:
 	TFunction<void(const FString& message)> OnError;
 
 	// Properties
+
+	// Creates the transport on Connect(); the engine WebSocket is used when unset.
+	TransportFactory CreateTransport;
+
+	// Reassembly buffer for the frame currently being received in fragments
 	TArray<uint8> ReceiveBuffer;
+	FrameBufferPool BufferPool;
+
+	// When set, every complete inbound frame is also passed to this recorder, which writes it while open.
+	// Set before Connect() and leave it alone afterwards: frames may be recorded on the transport's thread.
+	TSharedPtr<FrameRecorder> Recorder;
+
+private:
+	void HandleEvent(FrameQueue::EventType Type, int32 StatusCode = 0, const FString& Reason = FString(), bool bWasClean = false);
+	void HandleFrame(const void* Data, SIZE_T Size, TArray<uint8>* OwnedBuffer);
+
+	TUniquePtr<FrameQueue> Queue;
+	TUniquePtr<SendQueue> OutboundQueue;
+	Log2Histogram QueueLatencyMicros;
+	// EnqueuedCycles of the message OnMessage is handling from PumpEvents(), 0 otherwise
+	uint64 DispatchingEnqueuedCycles = 0;
 };
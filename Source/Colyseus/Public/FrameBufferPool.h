@@ -0,0 +1,43 @@
+#pragma once
+
+#include <CoreMinimal.h>
+#include <HAL/CriticalSection.h>
+
+#include <atomic>
+
+/**
+ * Recycles the buffers used to reassemble fragmented frames, so large state messages reuse an
+ * existing allocation instead of growing a new one fragment by fragment.
+ *
+ * Buffers larger than HighWatermark are kept only while large frames keep arriving; after
+ * ShrinkAfter smaller frames in a row (as reported to NoteFrame()) they are released, so one huge
+ * message does not pin its memory for the rest of the session.
+ */
+class COLYSEUSCLIENT_API FrameBufferPool
+{
+public:
+	FrameBufferPool(int32 MaxPooledBuffers = 4, int64 HighWatermark = 256 * 1024, int32 ShrinkAfter = 16);
+
+	// Methods
+
+	/** Returns an empty buffer that can hold at least ExpectedSize bytes without reallocating. */
+	TArray<uint8> Acquire(int64 ExpectedSize);
+
+	/** Gives a buffer back; its contents are discarded but its allocation may be reused. */
+	void Release(TArray<uint8>&& Buffer);
+
+	/** Counts a complete frame, pooled or not; this is what lets oversized buffers go once frames shrink. */
+	void NoteFrame(int64 Size);
+
+	int64 GetPooledBytes() const;
+
+private:
+	int32 MaxPooledBuffers;
+	int64 HighWatermark;
+	int32 ShrinkAfter;
+
+	mutable FCriticalSection Lock;
+	TArray<TArray<uint8>> FreeBuffers;
+	// Stops counting at ShrinkAfter
+	std::atomic<int32> SmallFramesInARow{0};
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <CoreMinimal.h>
+#include <HAL/CriticalSection.h>
+
+#include <atomic>
+
+/**
+ * Single-producer/single-consumer queue of connection events. The receive side pushes complete
+ * frames (and open/close/error notifications) as they arrive, and the consumer drains them at a
+ * point of its choosing, usually once per game frame.
+ *
+ * Events live in a fixed ring of preallocated slots and frame bytes are moved in, so steady-state
+ * traffic does not allocate. If the consumer falls behind and the ring fills up, events spill into
+ * a locked overflow list; ordering is preserved either way.
+ */
+class COLYSEUSCLIENT_API FrameQueue
+{
+public:
+	enum class EventType : uint8
+	{
+		Open,
+		Message,
+		Close,
+		Error,
+	};
+
+	struct Event
+	{
+		EventType Type = EventType::Message;
+		TArray<uint8> Bytes;
+		int32 StatusCode = 0;
+		FString Reason;
+		bool bWasClean = false;
+		uint64 EnqueuedCycles = 0;
+	};
+
+	/** Capacity is rounded up to a power of two. */
+	FrameQueue(uint32 Capacity = 256);
+
+	// Methods
+
+	/** Producer side. */
+	void Enqueue(Event&& Item);
+
+	/** Consumer side: visits up to MaxEvents events in arrival order and returns how many were visited. */
+	int32 Drain(const TFunction<void(Event&)>& Visitor, int32 MaxEvents = MAX_int32);
+
+	inline uint64 GetOverflowCount() const
+	{
+		return OverflowCount.load(std::memory_order_relaxed);
+	}
+
+private:
+	bool TryPush(Event& Item);
+	bool TryPop(Event& Out);
+
+	TArray<Event> Slots;
+	uint32 Mask;
+	std::atomic<uint32> Head;
+	std::atomic<uint32> Tail;
+
+	// Set by the producer when the ring was full; cleared by the consumer once the overflow is drained.
+	std::atomic<bool> bOverflowing;
+	FCriticalSection OverflowLock;
+	TArray<Event> Overflow;
+	std::atomic<uint64> OverflowCount;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <CoreMinimal.h>
+#include <GenericPlatform/GenericPlatformFile.h>
+#include <HAL/CriticalSection.h>
+
+#include <atomic>
+
+/**
+ * Writes every complete inbound frame to a file, with its arrival time, so a session
+ * can be replayed offline through FrameReplay. Record() is a no-op while no file is open, and
+ * all methods can be called from any thread.
+ *
+ * File layout: "CYFR", format version, then per frame a uint64 timestamp in microseconds
+ * since recording started, a uint32 size and the frame bytes (little-endian).
+ */
+class COLYSEUSCLIENT_API FrameRecorder
+{
+public:
+	~FrameRecorder();
+
+	// Methods
+	bool Open(const FString& Path);
+	void Close();
+	void Record(const void* Data, SIZE_T Size);
+
+	bool IsOpen() const;
+
+private:
+	mutable FCriticalSection Lock;
+	TUniquePtr<IFileHandle> File;
+	// Lets Record() skip the lock while nothing is being recorded
+	std::atomic<bool> bRecording{false};
+	double StartTime = 0.0;
+};
+
+/**
+ * Loads a recording made by FrameRecorder and feeds its frames to a message handler,
+ * either as fast as possible or at the recorded pace.
+ */
+class COLYSEUSCLIENT_API FrameReplay
+{
+public:
+	struct Result
+	{
+		int32 Frames = 0;
+		uint64 Bytes = 0;
+		double Seconds = 0.0;
+	};
+
+	// Methods
+	bool Load(const FString& Path);
+
+	/** Calls Handler(Data, Size, 0) for each frame; the data is only valid during the call. */
+	Result Play(const TFunction<void(const void* Data, SIZE_T Size, SIZE_T BytesRemaining)>& Handler, bool bRealTime) const;
+
+	inline int32 Num() const
+	{
+		return Frames.Num();
+	}
+
+private:
+	struct Frame
+	{
+		uint64 Micros;
+		int64 Offset;
+		uint32 Size;
+	};
+
+	TArray<uint8> Contents;
+	TArray<Frame> Frames;
+};
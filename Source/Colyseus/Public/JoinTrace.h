@@ -0,0 +1,95 @@
+#pragma once
+
+#include "RoomStats.h"
+
+#include <CoreMinimal.h>
+
+/** Phases of a join, in the order they happen. */
+enum class EJoinPhase : uint8
+{
+	RequestSent,
+	ResponseReceived,
+	SocketOpen,
+	// JOIN_ROOM handshake handled
+	JoinRoom,
+	FirstStateDecoded,
+	// First OnStateChange returned
+	FirstStateChange,
+	Count
+};
+
+/**
+ * FPlatformTime::Seconds() at each phase of one join, 0 for phases not reached. Client fills in the
+ * matchmake phases and Room<S> the connection ones.
+ */
+struct COLYSEUSCLIENT_API JoinTrace
+{
+	static constexpr int32 NumPhases = (int32) EJoinPhase::Count;
+
+	double Timestamps[NumPhases] = {};
+
+	// WebSockets module load, overlapped with the matchmake request
+	double ModuleLoadSeconds = 0.0;
+
+	FString RoomName;
+	FString RoomId;
+
+	// Methods
+	void Mark(EJoinPhase Phase);
+
+	inline bool Has(EJoinPhase Phase) const
+	{
+		return Timestamps[(int32) Phase] > 0.0;
+	}
+
+	/** Seconds from the closest earlier phase reached to Phase; 0 when Phase was not reached. */
+	double GetPhaseSeconds(EJoinPhase Phase) const;
+
+	/** Seconds from the first phase reached to the last. */
+	double GetTotalSeconds() const;
+
+	static const TCHAR* GetPhaseName(EJoinPhase Phase);
+};
+
+/** Coarse summary of a JoinTrace, in seconds, for callers that only need the main stages. */
+struct COLYSEUSCLIENT_API JoinTimings
+{
+	// WebSockets module load, overlapped with the matchmake request
+	double ModuleLoadSeconds = 0.0;
+	// Matchmake request sent to response received
+	double MatchMakeSeconds = 0.0;
+	// Response received (including parsing it) to JOIN_ROOM handled
+	double ConnectSeconds = 0.0;
+	double TotalSeconds = 0.0;
+
+	static JoinTimings FromTrace(const JoinTrace& Trace);
+};
+
+struct COLYSEUSCLIENT_API JoinTraceStatsSnapshot
+{
+	uint64 Joins = 0;
+
+	// Per phase, time since the phase before it, in microseconds
+	uint64 PhaseMicrosP50[JoinTrace::NumPhases] = {};
+	uint64 PhaseMicrosP99[JoinTrace::NumPhases] = {};
+	uint64 PhaseMicrosMax[JoinTrace::NumPhases] = {};
+
+	uint64 TotalMicrosP50 = 0;
+	uint64 TotalMicrosP99 = 0;
+	uint64 TotalMicrosMax = 0;
+};
+
+/** Histograms of completed join traces; Record() and Snapshot() can run on any thread. */
+class COLYSEUSCLIENT_API JoinTraceStats
+{
+public:
+	// Methods
+	void Record(const JoinTrace& Trace);
+
+	JoinTraceStatsSnapshot Snapshot() const;
+	void Reset();
+
+private:
+	Log2Histogram PhaseMicros[JoinTrace::NumPhases];
+	Log2Histogram TotalMicros;
+};
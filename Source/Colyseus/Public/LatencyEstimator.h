@@ -0,0 +1,85 @@
+#pragma once
+
+#include "RoomStats.h"
+
+#include <CoreMinimal.h>
+
+/**
+ * Smoothed round-trip time, jitter and server clock offset from ping/pong samples.
+ *
+ * RTT and jitter follow the TCP retransmission timer estimator (RFC 6298): gains of 1/8 for the
+ * smoothed RTT and 1/4 for the mean deviation. The clock offset is taken from the fastest of the
+ * recent samples, since a short round trip bounds the error of assuming a symmetric path.
+ */
+class COLYSEUSCLIENT_API LatencyEstimator
+{
+public:
+	// Reserved ROOM_DATA types; the server echoes PingType back as PongType, see README. The room
+	// consumes PongType messages itself, so OnMessage handlers never see them.
+	static const FString PingType;
+	static const FString PongType;
+
+	// Methods
+
+	/**
+	 * Adds one round trip. SentSeconds and ReceivedSeconds are local FPlatformTime::Seconds() readings,
+	 * ServerSeconds is the server's clock when it answered (Date.now(), in seconds since the Unix epoch).
+	 */
+	void AddSample(double SentSeconds, double ReceivedSeconds, double ServerSeconds);
+
+	void Reset();
+
+	/** Converts a local FPlatformTime::Seconds() reading to the server's clock, in Unix epoch seconds. */
+	inline double ToServerTime(double LocalSeconds) const
+	{
+		return LocalSeconds + ClockOffset;
+	}
+
+	inline double GetSmoothedRtt() const
+	{
+		return SmoothedRtt;
+	}
+
+	inline double GetJitter() const
+	{
+		return RttVariance;
+	}
+
+	/**
+	 * Server epoch clock minus FPlatformTime::Seconds(), in seconds. The local clock has an arbitrary
+	 * origin, so the value only means something through ToServerTime(FPlatformTime::Seconds()).
+	 */
+	inline double GetClockOffset() const
+	{
+		return ClockOffset;
+	}
+
+	inline int32 GetSampleCount() const
+	{
+		return SampleCount;
+	}
+
+	/** Every RTT sample, in microseconds. */
+	inline const Log2Histogram& GetRttMicros() const
+	{
+		return RttMicros;
+	}
+
+	// Samples considered when picking the clock offset
+	static constexpr int32 OffsetWindow = 8;
+
+private:
+	struct OffsetSample
+	{
+		double Rtt;
+		double Offset;
+	};
+
+	double SmoothedRtt = 0.0;
+	double RttVariance = 0.0;
+	double ClockOffset = 0.0;
+	int32 SampleCount = 0;
+
+	TArray<OffsetSample> RecentOffsets;
+	Log2Histogram RttMicros;
+};
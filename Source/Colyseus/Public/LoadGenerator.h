@@ -0,0 +1,360 @@
+#pragma once
+
+#include "Client.h"
+#include "LoopbackTransport.h"
+#include "Room.h"
+#include "RoomStats.h"
+#include "SocketTransport.h"
+
+#include <HAL/PlatformMemory.h>
+#include <HAL/PlatformTime.h>
+
+struct LoadGeneratorSettings
+{
+	// Server to join through the matchmaker, e.g. "ws://localhost:2567". When empty every client
+	// talks to an in-process LoopbackTransport echo stand-in instead.
+	FString Endpoint;
+	FString RoomName = TEXT("my_room");
+	JoinOptions Options;
+
+	int32 NumClients = 100;
+	// Clients joined per Tick(), to avoid hammering the matchmaker all at once
+	int32 JoinsPerTick = 50;
+
+	// Messages each client sends per second, and the padding added to each one
+	double MessagesPerSecond = 10.0;
+	int32 PayloadBytes = 32;
+	// Message type the traffic is sent as; the server must echo it back for latency to be measured
+	FString MessageType = TEXT("loadgen");
+
+	// Use SocketTransport instead of the engine WebSocket, so no engine tick is needed to pump sockets
+	bool bUseSocketTransport = true;
+};
+
+struct LoadGeneratorReport
+{
+	int32 ClientsJoined = 0;
+	int32 ClientsFailed = 0;
+	int32 ClientsLeft = 0;
+
+	uint64 MessagesSent = 0;
+	uint64 MessagesReceived = 0;
+	uint64 BytesIn = 0;
+	uint64 BytesOut = 0;
+
+	// Round trip of the scripted messages
+	uint64 LatencyMicrosP50 = 0;
+	uint64 LatencyMicrosP90 = 0;
+	uint64 LatencyMicrosP99 = 0;
+	uint64 LatencyMicrosMax = 0;
+
+	// Decode and dispatch time per client, per second of run time
+	double DecodeMicrosPerClientSecond = 0.0;
+	// Growth of used physical memory while the clients joined, divided by the clients joined
+	int64 MemoryPerRoomBytes = 0;
+
+	double Seconds = 0.0;
+};
+
+/**
+ * Runs many Room<S> instances in one process and drives scripted Send traffic through them, for
+ * finding scaling limits without an Unreal instance per player.
+ *
+ * Each client sends Settings.MessageType carrying its send time and expects it back. The loopback
+ * stand-in echoes every message; against a real server, add a handler that does the same:
+ *
+ *     this.onMessage("loadgen", (client, message) => client.send("loadgen", message));
+ *
+ * Everything happens on the thread calling Start() and Tick(). Tick() pumps every room, so rooms
+ * use queued events and no engine tick is needed when bUseSocketTransport is set.
+ */
+template <typename S = void>
+class LoadGenerator
+{
+public:
+	LoadGenerator(const LoadGeneratorSettings& Settings) : Settings(Settings)
+	{
+	}
+
+	~LoadGenerator()
+	{
+		Stop();
+	}
+
+	LoadGenerator(const LoadGenerator&) = delete;
+	LoadGenerator& operator=(const LoadGenerator&) = delete;
+
+	// Methods
+	void Start()
+	{
+		Stop();
+
+		StartTime = FPlatformTime::Seconds();
+		MemoryBefore = FPlatformMemory::GetStats().UsedPhysical;
+		Latency.Reset();
+		Counters = LoadGeneratorReport();
+
+		if (!Settings.Endpoint.IsEmpty())
+		{
+			MatchMaker = MakeShared<Client>(Settings.Endpoint);
+			if (Settings.bUseSocketTransport)
+			{
+				MatchMaker->CreateTransport = []() -> TSharedPtr<ITransport> { return MakeShared<SocketTransport>(); };
+			}
+		}
+
+		Padding = std::string(FMath::Max(0, Settings.PayloadBytes), 'x');
+		Bots.SetNum(Settings.NumClients);
+		for (int32 Index = 0; Index < Bots.Num(); Index++)
+		{
+			Bots[Index] = MakeShared<Bot>();
+		}
+		NextToJoin = 0;
+	}
+
+	/** Joins pending clients, sends the messages that are due and pumps every room. */
+	void Tick()
+	{
+		const double Now = FPlatformTime::Seconds();
+
+		const int32 JoinEnd = FMath::Min(Bots.Num(), NextToJoin + FMath::Max(1, Settings.JoinsPerTick));
+		for (; NextToJoin < JoinEnd; NextToJoin++)
+		{
+			Join(Bots[NextToJoin], Now);
+		}
+
+		const double Interval = Settings.MessagesPerSecond > 0.0 ? 1.0 / Settings.MessagesPerSecond : 0.0;
+		for (const TSharedPtr<Bot>& Each : Bots)
+		{
+			if (!Each->Instance.IsValid())
+			{
+				continue;
+			}
+
+			if (Each->Loopback.IsValid())
+			{
+				Each->Loopback->Tick();
+			}
+			Each->Instance->Tick();
+
+			if (!Each->bJoined || Interval <= 0.0)
+			{
+				continue;
+			}
+
+			// Catch up at most one second of missed sends, so a stall does not turn into a burst.
+			Each->NextSendTime = FMath::Max(Each->NextSendTime, Now - 1.0);
+			while (Each->NextSendTime <= Now)
+			{
+				SendOne(*Each);
+				Each->NextSendTime += Interval;
+			}
+		}
+
+		if (MemoryAfterJoin == 0 && AllSettled())
+		{
+			MemoryAfterJoin = FPlatformMemory::GetStats().UsedPhysical;
+		}
+	}
+
+	/** Leaves every room and releases the clients. */
+	void Stop()
+	{
+		for (const TSharedPtr<Bot>& Each : Bots)
+		{
+			if (Each->Instance.IsValid() && Each->bJoined)
+			{
+				Each->Instance->Leave(true);
+			}
+		}
+		Bots.Empty();
+		MatchMaker.Reset();
+	}
+
+	/** True once every client has joined or failed to. */
+	bool AllSettled() const
+	{
+		if (NextToJoin < Bots.Num())
+		{
+			return false;
+		}
+		for (const TSharedPtr<Bot>& Each : Bots)
+		{
+			if (!Each->bJoined && !Each->bFailed)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	LoadGeneratorReport Report() const
+	{
+		LoadGeneratorReport Result = Counters;
+		Result.Seconds = FPlatformTime::Seconds() - StartTime;
+		Result.LatencyMicrosP50 = Latency.GetPercentile(0.50);
+		Result.LatencyMicrosP90 = Latency.GetPercentile(0.90);
+		Result.LatencyMicrosP99 = Latency.GetPercentile(0.99);
+		Result.LatencyMicrosMax = Latency.GetMax();
+
+		uint64 DecodeMicros = 0;
+		for (const TSharedPtr<Bot>& Each : Bots)
+		{
+			if (!Each->Instance.IsValid())
+			{
+				continue;
+			}
+			const RoomStatsSnapshot Stats = Each->Instance->GetStats();
+			DecodeMicros += Stats.DecodeMicrosTotal + Stats.DispatchMicrosTotal;
+			Result.BytesIn += Stats.BytesIn;
+			Result.BytesOut += Stats.BytesOut;
+		}
+
+		if (Result.ClientsJoined > 0 && Result.Seconds > 0.0)
+		{
+			Result.DecodeMicrosPerClientSecond = DecodeMicros / (Result.ClientsJoined * Result.Seconds);
+		}
+		if (Result.ClientsJoined > 0 && MemoryAfterJoin > MemoryBefore)
+		{
+			Result.MemoryPerRoomBytes = (int64) (MemoryAfterJoin - MemoryBefore) / Result.ClientsJoined;
+		}
+		return Result;
+	}
+
+	// Properties
+	LoadGeneratorSettings Settings;
+
+private:
+	struct Bot
+	{
+		TSharedPtr<Room<S>> Instance;
+		TSharedPtr<LoopbackTransport> Loopback;
+		double NextSendTime = 0.0;
+		bool bJoined = false;
+		bool bFailed = false;
+	};
+
+	void Join(const TSharedPtr<Bot>& Each, double Now)
+	{
+		// Spread the first sends over one interval so the clients do not send in lockstep.
+		const double Interval = Settings.MessagesPerSecond > 0.0 ? 1.0 / Settings.MessagesPerSecond : 0.0;
+		Each->NextSendTime = Now + FMath::FRand() * Interval;
+
+		TWeakPtr<Bot> WeakBot = Each;
+		if (!MatchMaker.IsValid())
+		{
+			Each->Loopback = MakeShared<LoopbackTransport>();
+			Each->Loopback->EnableEchoStandIn();
+
+			TSharedPtr<LoopbackTransport> Transport = Each->Loopback;
+			Each->Instance = MakeShared<Room<S>>(Settings.RoomName);
+			Each->Instance->CreateTransport = [Transport]() -> TSharedPtr<ITransport> { return Transport; };
+			Each->Instance->bQueueNetworkEvents = true;
+			Each->Instance->OnJoin = [this, WeakBot]() { OnBotJoined(WeakBot.Pin()); };
+			Each->Instance->OnError = [this, WeakBot](int32 Code, const FString& Message) { OnBotFailed(WeakBot.Pin()); };
+			Each->Instance->Connect(TEXT("loopback://") + Settings.RoomName);
+			return;
+		}
+
+		// Created here rather than by the client, so Tick() pumps it while it joins: with the socket
+		// transport, JOIN_ROOM is only handled once Room::Tick() drains the connection's event queue.
+		Each->Instance = MakeShared<Room<S>>(Settings.RoomName);
+		MatchMaker->JoinOrCreate<S>(Settings.RoomName, Settings.Options,
+			[this, WeakBot](TSharedPtr<MatchMakeError> Error, TSharedPtr<Room<S>> Joined) {
+				TSharedPtr<Bot> Each = WeakBot.Pin();
+				if (!Each.IsValid())
+				{
+					return;
+				}
+				if (Error.IsValid())
+				{
+					OnBotFailed(Each);
+					return;
+				}
+				OnBotJoined(Each);
+			},
+			Each->Instance);
+	}
+
+	void OnBotJoined(const TSharedPtr<Bot>& Each)
+	{
+		if (!Each.IsValid() || Each->bJoined)
+		{
+			return;
+		}
+		Each->bJoined = true;
+		Counters.ClientsJoined++;
+
+		TWeakPtr<Bot> WeakBot = Each;
+		Each->Instance->OnMessage(Settings.MessageType, [this](const msgpack::object& Message) { OnEcho(Message); });
+		Each->Instance->OnLeave = [this, WeakBot](int32 StatusCode) {
+			if (TSharedPtr<Bot> Left = WeakBot.Pin())
+			{
+				Left->bJoined = false;
+				Counters.ClientsLeft++;
+			}
+		};
+	}
+
+	void OnBotFailed(const TSharedPtr<Bot>& Each)
+	{
+		if (!Each.IsValid() || Each->bFailed)
+		{
+			return;
+		}
+		Each->bFailed = true;
+		Counters.ClientsFailed++;
+	}
+
+	void SendOne(Bot& Each)
+	{
+		// [send time, padding]. The time is microseconds since Start(), wrapped to 32 bits: servers may echo
+		// larger integers back as float64, which would lose precision.
+		const uint32 SentMicros = NowMicros();
+		Each.Instance->Send(Settings.MessageType, msgpack::type::make_tuple(SentMicros, Padding));
+		Counters.MessagesSent++;
+	}
+
+	void OnEcho(const msgpack::object& Message)
+	{
+		Counters.MessagesReceived++;
+		if (Message.type != msgpack::type::ARRAY || Message.via.array.size < 1)
+		{
+			return;
+		}
+
+		const msgpack::object& Sent = Message.via.array.ptr[0];
+		uint32 SentMicros = 0;
+		if (Sent.type == msgpack::type::POSITIVE_INTEGER)
+		{
+			SentMicros = (uint32) Sent.via.u64;
+		}
+		else if (Sent.type == msgpack::type::FLOAT64 || Sent.type == msgpack::type::FLOAT32)
+		{
+			SentMicros = (uint32) Sent.via.f64;
+		}
+		else
+		{
+			return;
+		}
+
+		// Unsigned wrap-around keeps the difference right across the 32-bit boundary.
+		Latency.Record((uint32) (NowMicros() - SentMicros));
+	}
+
+	inline uint32 NowMicros() const
+	{
+		return (uint32) (uint64) ((FPlatformTime::Seconds() - StartTime) * 1e6);
+	}
+
+	TSharedPtr<Client> MatchMaker;
+	TArray<TSharedPtr<Bot>> Bots;
+	int32 NextToJoin = 0;
+	std::string Padding;
+
+	LoadGeneratorReport Counters;
+	Log2Histogram Latency;
+	double StartTime = 0.0;
+	uint64 MemoryBefore = 0;
+	uint64 MemoryAfterJoin = 0;
+};
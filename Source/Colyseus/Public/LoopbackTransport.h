@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Transport.h"
+
+/**
+ * In-process transport with no network underneath, for benchmarks and bots. Whatever the client
+ * sends goes to OnServerReceive, and Deliver() pushes frames to the client as if the server sent them.
+ *
+ * Everything runs synchronously on the calling thread. Setting SimulatedBytesPerSecond holds sent
+ * frames back until Tick() has let enough time pass, to stand in for a slow link.
+ */
+class COLYSEUSCLIENT_API LoopbackTransport : public ITransport
+{
+public:
+	// Methods
+	void Connect(const FString& Url) override;
+	void Send(const void* Data, SIZE_T Size) override;
+	void Close(int32 Code, const FString& Reason) override;
+	int64 GetBufferedAmount() const override;
+
+	/** Sends a frame to the client, split into fragments of FragmentSize bytes if non-zero. */
+	void Deliver(const void* Data, SIZE_T Size, SIZE_T FragmentSize = 0);
+
+	/** Closes the connection from the server side. */
+	void Disconnect(int32 Code = 1000, const FString& Reason = FString());
+
+	/** Moves simulated in-flight bytes to the server, according to SimulatedBytesPerSecond. */
+	void Tick();
+
+	/**
+	 * Makes this transport behave like a minimal room: it accepts the join, echoes ROOM_DATA frames
+	 * back to the client, answers latency pings and closes on LEAVE_ROOM.
+	 */
+	void EnableEchoStandIn(const FString& SerializerId = TEXT("none"));
+
+	// Callbacks
+	TFunction<void(LoopbackTransport& Transport, const uint8* Data, SIZE_T Size)> OnServerReceive;
+
+	// Properties
+	FString Url;
+	bool bConnected = false;
+	int64 SimulatedBytesPerSecond = 0;
+	// Added to the stand-in's clock when it answers pings, to exercise clock offset estimation
+	double StandInClockOffset = 0.0;
+
+private:
+	void ReceiveOnServer(const uint8* Data, SIZE_T Size);
+	bool AnswerPing(const uint8* Data, SIZE_T Size);
+
+	bool bEchoStandIn = false;
+	FString StandInSerializerId;
+
+	TArray<TArray<uint8>> InFlight;
+	int64 InFlightBytes = 0;
+	int64 InFlightSentOfFirst = 0;
+	double LastTickTime = 0.0;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <CoreMinimal.h>
+#include <Interfaces/IHttpRequest.h>
+#include <Interfaces/IHttpResponse.h>
+
+struct COLYSEUSCLIENT_API MatchMakeHttpStats
+{
+	uint64 Requests = 0;
+	// Requests that waited for a free slot
+	uint64 QueuedRequests = 0;
+	int32 InFlight = 0;
+	int32 Waiting = 0;
+};
+
+/** What a matchmaking call got back; Code is 0 when no response arrived. */
+struct COLYSEUSCLIENT_API MatchMakeHttpResponse
+{
+	int32 Code = 0;
+	TArray<uint8> Content;
+	TMap<FString, FString> Headers;
+
+	// Methods
+	inline FString GetHeader(const FString& Name) const
+	{
+		const FString* Value = Headers.Find(Name);
+		return Value ? *Value : FString();
+	}
+};
+
+/**
+ * HTTP layer for matchmaking calls: requests can be capped with MaxConcurrentRequests (the rest are
+ * queued in order), answered in process by a stand-in, and counted. Connection reuse is left to the
+ * engine's HTTP backend.
+ * Use it from the game thread, where HTTP completion callbacks run.
+ */
+class COLYSEUSCLIENT_API MatchMakeHttp : public TSharedFromThis<MatchMakeHttp>
+{
+public:
+	typedef TSharedRef<IHttpRequest, ESPMode::ThreadSafe> RequestRef;
+	typedef TFunction<void(const MatchMakeHttpResponse& Response, bool bWasSuccessful)> ResponseHandler;
+	typedef TFunction<void(const IHttpRequest& Request, MatchMakeHttpResponse& OutResponse)> StandInHandler;
+
+	// Methods
+
+	/** Creates a request with the Accept header set; add the body, then Enqueue() it. */
+	RequestRef CreateRequest(const FString& Verb, const FString& Url) const;
+
+	/**
+	 * Sends Request once a slot is free. OnSent runs right before it goes out, after any wait for a
+	 * slot; Handler runs on the game thread, and not at all if this object is destroyed first.
+	 */
+	void Enqueue(RequestRef Request, const ResponseHandler& Handler, const TFunction<void()>& OnSent = nullptr);
+
+	/**
+	 * Answers matchmake calls in process, for benchmarks and bots: joins get fresh room and session
+	 * ids, room listings an empty list. Pair it with LoopbackTransport::EnableEchoStandIn().
+	 */
+	void EnableLoopbackStandIn();
+
+	MatchMakeHttpStats GetStats() const;
+
+	// Properties
+	// 0 runs every request as soon as it is enqueued
+	int32 MaxConcurrentRequests = 0;
+
+	// When set, requests never reach the network; StandIn fills in the response synchronously.
+	StandInHandler StandIn;
+
+private:
+	struct PendingRequest
+	{
+		RequestRef Request;
+		ResponseHandler Handler;
+		TFunction<void()> OnSent;
+	};
+
+	void Process(const PendingRequest& Pending);
+
+	inline bool IsFull() const
+	{
+		return MaxConcurrentRequests > 0 && InFlight >= MaxConcurrentRequests;
+	}
+
+	void StartWaiting();
+
+	TArray<PendingRequest> Waiting;
+	int32 InFlight = 0;
+
+	uint64 Requests = 0;
+	uint64 QueuedRequests = 0;
+};
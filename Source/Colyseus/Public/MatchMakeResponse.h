@@ -0,0 +1,27 @@
+#pragma once
+
+#include <CoreMinimal.h>
+
+#include <string>
+
+/**
+ * The fields a join needs from a matchmake response: room.roomId, room.processId and sessionId,
+ * or the error/code pair. Parse() reads them in one SAX pass, skipping everything else (such as
+ * room metadata) without building a JSON DOM.
+ */
+struct COLYSEUSCLIENT_API MatchMakeResponse
+{
+	std::string RoomId;
+	std::string ProcessId;
+	std::string SessionId;
+
+	bool bHasError = false;
+	std::string Error;
+	int32 Code = 0;
+
+	/**
+	 * Returns false and sets ParseError if Data is not valid JSON, or if it carries no error but lacks
+	 * room.roomId, room.processId or sessionId.
+	 */
+	bool Parse(const uint8* Data, SIZE_T Size, std::string& ParseError);
+};
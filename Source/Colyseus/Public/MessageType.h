@@ -0,0 +1,35 @@
+#pragma once
+
+#include <CoreMinimal.h>
+
+/**
+ * A ROOM_DATA message type whose protocol code and type header are encoded once, up front.
+ * Create one per type with Room::RegisterMessageType() and reuse it for every Send().
+ */
+class COLYSEUSCLIENT_API MessageType
+{
+public:
+	explicit MessageType(const FString& Name);
+	explicit MessageType(int32 Type);
+
+	/** Protocol code followed by the encoded type; the payload (if any) goes right after it. */
+	inline const TArray<uint8>& GetPrefix() const
+	{
+		return Prefix;
+	}
+
+	/** Queued sends of this type replace each other, so only the latest one goes out. */
+	inline uint32 GetCoalesceKey() const
+	{
+		return bCoalesce ? GetTypeHash(Name) | 1 : 0;
+	}
+
+	// Properties
+	FString Name;
+
+	// Only affects rooms with a send queue, see Connection::EnableSendQueue()
+	bool bCoalesce = false;
+
+private:
+	TArray<uint8> Prefix;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <CoreMinimal.h>
+
+#include <atomic>
+
+THIRD_PARTY_INCLUDES_START
+#pragma push_macro("check")
+#undef check
+#include <msgpack.hpp>
+#pragma pop_macro("check")
+THIRD_PARTY_INCLUDES_END
+
+/**
+ * Keeps a small set of msgpack zones alive between ROOM_DATA messages, so unpacking a payload
+ * reuses the zone's first chunk instead of allocating and freeing a fresh zone every time.
+ * Only GetStats() may be called from a thread other than the one unpacking messages.
+ */
+class COLYSEUSCLIENT_API MessageZonePool
+{
+public:
+	/** Returns its zone to the pool when it goes out of scope, even if a handler throws. */
+	class ScopedZone
+	{
+	public:
+		ScopedZone(MessageZonePool& Pool) : Pool(Pool), Zone(Pool.Acquire())
+		{
+		}
+
+		~ScopedZone()
+		{
+			Pool.Release(Zone);
+		}
+
+		ScopedZone(const ScopedZone&) = delete;
+		ScopedZone& operator=(const ScopedZone&) = delete;
+
+		inline msgpack::zone& Get() const
+		{
+			return *Zone;
+		}
+
+	private:
+		MessageZonePool& Pool;
+		msgpack::zone* Zone;
+	};
+
+	struct Stats
+	{
+		// Zones created because the pool was empty
+		uint64 Allocations = 0;
+		// Zones handed out, reused or not
+		uint64 Acquisitions = 0;
+		// Payloads larger than one chunk, which make the zone allocate extra chunks
+		uint64 OversizedPayloads = 0;
+	};
+
+	MessageZonePool(SIZE_T ChunkSize = MSGPACK_ZONE_CHUNK_SIZE, int32 MaxPooledZones = 2);
+
+	// Methods
+	msgpack::zone* Acquire();
+	void Release(msgpack::zone* Zone);
+
+	/** Records the size of a payload about to be unpacked, to track chunk overflows. */
+	void NotePayloadSize(SIZE_T PayloadSize);
+
+	/** Zone allocations per second since the previous call (or since construction). */
+	double SampleAllocationsPerSecond();
+
+	Stats GetStats() const;
+	void ResetStats();
+
+private:
+	SIZE_T ChunkSize;
+	int32 MaxPooledZones;
+	TArray<TUniquePtr<msgpack::zone>> FreeZones;
+
+	std::atomic<uint64> Allocations;
+	std::atomic<uint64> Acquisitions;
+	std::atomic<uint64> OversizedPayloads;
+	double LastSampleTime;
+	uint64 LastSampleAllocations = 0;
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <CoreMinimal.h>
+
+struct COLYSEUSCLIENT_API PatchJitterBufferSettings
+{
+	// Bounds of the hold time; within them it follows JitterMultiplier times the measured jitter
+	double MinDelay = 0.0;
+	double MaxDelay = 0.25;
+	double JitterMultiplier = 3.0;
+	// Patch interval assumed until enough patches have arrived to measure it (20 Hz, the server default)
+	double InitialInterval = 0.05;
+	// Arrival gaps longer than this many intervals are taken as idle time and left out of the estimates
+	double IdleGapIntervals = 4.0;
+};
+
+struct COLYSEUSCLIENT_API PatchJitterBufferStats
+{
+	int32 BufferedPatches = 0;
+	// Current hold time, measured inter-arrival jitter and patch interval, in seconds
+	double Delay = 0.0;
+	double Jitter = 0.0;
+	double Interval = 0.0;
+	// Patches that arrived after the time they were due, and backlog applied early to catch up
+	uint64 LatePatches = 0;
+	uint64 CatchUpPatches = 0;
+};
+
+/**
+ * Holds ROOM_STATE_PATCH payloads for an adaptive delay and releases them at the server's patch
+ * rate, so arrival jitter does not show up as uneven state updates.
+ *
+ * The interval between patches and its jitter are tracked with 1/8 gain moving averages. The server
+ * sends no patch while the state is unchanged, so long gaps only count once they keep coming (the
+ * patch rate went down). A patch is released one interval after the previous one, but never before
+ * it has been held for the current delay nor later than MaxDelay after it arrived. If the backlog
+ * outgrows the delay (the server runs faster than estimated), the oldest patches are released
+ * immediately.
+ * Not thread-safe: use it from the thread that handles room messages.
+ */
+class COLYSEUSCLIENT_API PatchJitterBuffer
+{
+public:
+	typedef TFunction<void(const TArray<uint8>& Patch)> PatchVisitor;
+
+	PatchJitterBuffer(const PatchJitterBufferSettings& Settings = PatchJitterBufferSettings());
+
+	// Methods
+	void Push(const void* Data, SIZE_T Size, double ArrivalSeconds);
+
+	/** Passes the patches due by Now to Visitor, oldest first. Returns how many were applied. */
+	int32 Drain(double Now, const PatchVisitor& Visitor);
+
+	/** Passes every buffered patch to Visitor, e.g. before a full state replaces them. */
+	int32 Flush(const PatchVisitor& Visitor);
+
+	/** Forgets buffered patches and timing estimates, e.g. for a new connection. */
+	void Reset();
+
+	PatchJitterBufferStats GetStats() const;
+
+	inline bool IsEmpty() const
+	{
+		return Patches.Num() == 0;
+	}
+
+	// Properties
+	PatchJitterBufferSettings Settings;
+
+private:
+	struct BufferedPatch
+	{
+		TArray<uint8> Bytes;
+		double ArrivalSeconds;
+		// Arrived after an idle gap, so it is never counted as late
+		bool bAfterIdleGap = false;
+	};
+
+	double GetDelay() const;
+	double GetDueTime(const BufferedPatch& Patch) const;
+
+	TArray<BufferedPatch> Patches;
+
+	double Interval;
+	double Jitter = 0.0;
+	double LastArrival = -1.0;
+	double LastRelease = -1.0;
+	// Consecutive idle gaps; after IdleGapsToAdapt of them they are taken as the new interval
+	int32 IdleGaps = 0;
+	static constexpr int32 IdleGapsToAdapt = 4;
+
+	uint64 LatePatches = 0;
+	uint64 CatchUpPatches = 0;
+};
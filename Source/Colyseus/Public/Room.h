@@ -1,15 +1,22 @@
 #pragma once
 
 #include "Connection.h"
+#include "JoinTrace.h"
+#include "LatencyEstimator.h"
+#include "MessageType.h"
+#include "MessageZonePool.h"
+#include "PatchJitterBuffer.h"
 #include "Protocol.h"
+#include "RoomStats.h"
 #include "Serializer/SchemaSerializer.hpp"
 #include "Serializer/Serializer.hpp"
 #include "Serializer/schema.h"
 
+#include <Async/MappedFileHandle.h>
+#include <HAL/PlatformFilemanager.h>
+#include <Misc/FileHelper.h>
 #include <stdio.h>
 
-#include <sstream>
-
 THIRD_PARTY_INCLUDES_START
 #pragma push_macro("check")
 #undef check
@@ -26,17 +33,118 @@ public:
 	}
 
 	// Methods
-	void Connect(const FString& Endpoint)
+
+	// StartedTrace carries the phases timed before the connection (matchmaking); see GetJoinTrace().
+	void Connect(const FString& Endpoint, const JoinTrace& StartedTrace = JoinTrace())
 	{
+		bHasJoined = false;
+		Trace = StartedTrace;
+		bTracingJoin = true;
+		PatchBuffer.Settings = JitterSettings;
+		PatchBuffer.Reset();
 		ConnectionInstance = MakeShared<Connection>();
+		ConnectionInstance->OnOpen = std::bind(&Room::_onOpen, this);
 		ConnectionInstance->OnClose =
 			std::bind(&Room::_onClose, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
 		ConnectionInstance->OnError = std::bind(&Room::_onError, this, std::placeholders::_1);
 		ConnectionInstance->OnMessage =
 			std::bind(&Room::_onMessage, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+		ConnectionInstance->Recorder = Recorder;
+		ConnectionInstance->CreateTransport = CreateTransport;
+		if (bQueueNetworkEvents)
+		{
+			ConnectionInstance->EnableEventQueue();
+		}
+		if (bQueueOutbound)
+		{
+			ConnectionInstance->EnableSendQueue(OutboundSettings);
+		}
 		ConnectionInstance->Connect(Endpoint);
 	}
 
+	// Handles network events queued since the last call, applies buffered patches that are due, flushes
+	// paced sends and sends automatic pings.
+	// Only needed when bQueueNetworkEvents, bQueueOutbound, bBufferPatches or PingInterval is set.
+	void Tick()
+	{
+		if (ConnectionInstance)
+		{
+			ConnectionInstance->PumpEvents();
+		}
+
+		if (!PatchBuffer.IsEmpty())
+		{
+			auto Apply = [this](const TArray<uint8>& Patch) { ApplyPatch(Patch.GetData(), 0, Patch.Num()); };
+			if (bBufferPatches)
+			{
+				PatchBuffer.Drain(FPlatformTime::Seconds(), Apply);
+			}
+			else
+			{
+				PatchBuffer.Flush(Apply);
+			}
+		}
+
+		if (ConnectionInstance)
+		{
+			if (PingInterval > 0.0 && bHasJoined && FPlatformTime::Seconds() - LastPingTime >= PingInterval)
+			{
+				Ping();
+			}
+
+			ConnectionInstance->FlushSendQueue();
+		}
+	}
+
+	// Sends a latency probe; the answer updates GetLatency(). Needs the server-side handler from the README.
+	// Probes skip the send queue, so pacing and eviction cannot delay them and the time they carry is taken
+	// as they reach the transport.
+	void Ping()
+	{
+		if (!ConnectionInstance || bReplaying)
+		{
+			return;
+		}
+
+		const TArray<uint8>& Prefix = PingMessage.GetPrefix();
+		msgpack::sbuffer Buffer;
+		Buffer.write(reinterpret_cast<const char*>(Prefix.GetData()), Prefix.Num());
+		LastPingTime = FPlatformTime::Seconds();
+		msgpack::pack(Buffer, LastPingTime);
+
+		Stats.RecordFrameOut(Buffer.size());
+		ConnectionInstance->SendImmediate(Buffer.data(), Buffer.size());
+	}
+
+	const LatencyEstimator& GetLatency() const
+	{
+		return Latency;
+	}
+
+	// Records every inbound frame to Path until StopRecording(); can be started before or after Connect().
+	// The connection keeps the same recorder for its whole life, as it may record on the transport's thread;
+	// only the recorder's file is opened and closed here.
+	bool StartRecording(const FString& Path)
+	{
+		return Recorder->Open(Path);
+	}
+
+	void StopRecording()
+	{
+		Recorder->Close();
+	}
+
+	// Feeds a recording through the message path, for profiling. Nothing is sent and the socket is not
+	// closed while it plays (not for the JOIN_ROOM ack, nor for what handlers do), so a connected room
+	// does not answer the server for frames it never sent.
+	FrameReplay::Result Replay(const FrameReplay& Recording, bool bRealTime = false)
+	{
+		TGuardValue<bool> Replaying(bReplaying, true);
+		return Recording.Play(
+			[this](const void* Data, SIZE_T Size, SIZE_T BytesRemaining) { _onMessage(Data, Size, BytesRemaining); },
+			bRealTime);
+	}
+
 	void Leave(bool bConsented = true)
 	{
 		if (!Id.IsEmpty())
@@ -44,9 +152,9 @@ public:
 			if (bConsented)
 			{
 				unsigned char bytes[1] = {(unsigned char) Colyseus::Protocol::LEAVE_ROOM};
-				ConnectionInstance->Send(bytes, sizeof(bytes));
+				SendBytes(bytes, sizeof(bytes), 0, false);
 			}
-			else
+			else if (ConnectionInstance && !bReplaying)
 			{
 				ConnectionInstance->Close();
 			}
@@ -63,57 +171,52 @@ public:
 	inline void Send(unsigned char Type)
 	{
 		unsigned char Message[2] = {(unsigned char) Colyseus::Protocol::ROOM_DATA, Type};
-		ConnectionInstance->Send(Message, sizeof(Message));
+		SendBytes(Message, sizeof(Message));
 	}
 
 	template <typename T>
 	void Send(const int32_t& Type, T Message)
 	{
-		std::stringstream PackingStream;
-		msgpack::pack(PackingStream, Message);
-		std::string Encoded = PackingStream.str();
-		size_t EncodedLength = Encoded.length();
-
-		TArray<uint8> BytesToSend;
-		BytesToSend.Reserve(2 + EncodedLength);
-		BytesToSend.Add((uint8)Colyseus::Protocol::ROOM_DATA);
-		BytesToSend.Add((uint8)Type);
-		BytesToSend.Append((const uint8*)Encoded.c_str(), EncodedLength);
-		ConnectionInstance->Send(BytesToSend.GetData(), BytesToSend.Num());
+		Send(MessageType(Type), Message);
 	}
 
 	void Send(const FString& Type)
 	{
-		FTCHARToUTF8 TypeBytes(*Type);
-		size_t TypeLength = TypeBytes.Length();
+		Send(MessageType(Type));
+	}
 
-		TArray<uint8> BytesToSend;
-		BytesToSend.Reserve(2 + TypeLength);
-		BytesToSend.Add((uint8)Colyseus::Protocol::ROOM_DATA);
-		BytesToSend.Add(Type.Len() | 0xa0);
-		BytesToSend.Append((const uint8*)TypeBytes.Get(), TypeLength);
-		ConnectionInstance->Send(BytesToSend.GetData(), BytesToSend.Num());
+	template <typename T>
+	void Send(const FString& Type, T Message)
+	{
+		Send(MessageType(Type), Message);
+	}
 
+	inline void Send(const MessageType& Type)
+	{
+		const TArray<uint8>& Prefix = Type.GetPrefix();
+		SendBytes(Prefix.GetData(), Prefix.Num(), Type.GetCoalesceKey());
 	}
 
 	template <typename T>
-	void Send(const FString& Type, T Message)
+	void Send(const MessageType& Type, const T& Message)
 	{
-		FTCHARToUTF8 TypeBytes(*Type);
-		size_t TypeLength = TypeBytes.Length();
+		const TArray<uint8>& Prefix = Type.GetPrefix();
+
+		// Pack straight after the cached header so the frame is built in a single buffer.
+		msgpack::sbuffer Buffer;
+		Buffer.write(reinterpret_cast<const char*>(Prefix.GetData()), Prefix.Num());
+		msgpack::pack(Buffer, Message);
+		SendBytes(Buffer.data(), Buffer.size(), Type.GetCoalesceKey());
+	}
 
-		std::stringstream PackingStream;
-		msgpack::pack(PackingStream, Message);
-		std::string Encoded = PackingStream.str();
-		size_t EncodedLength = Encoded.length();
+	inline MessageType RegisterMessageType(const FString& Type) const
+	{
+		return MessageType(Type);
+	}
 
-		TArray<uint8> BytesToSend;
-		BytesToSend.Reserve(2 + TypeLength + EncodedLength);
-		BytesToSend.Add((uint8) Colyseus::Protocol::ROOM_DATA);
-		BytesToSend.Add(Type.Len() | 0xa0);
-		BytesToSend.Append((const uint8*)TypeBytes.Get(), TypeLength);
-		BytesToSend.Append((const uint8*)Encoded.c_str(), EncodedLength);
-		ConnectionInstance->Send(BytesToSend.GetData(), BytesToSend.Num());
+	inline MessageType RegisterMessageType(const int32 Type) const
+	{
+		return MessageType(Type);
 	}
 
 	inline Room<S>* OnMessage(const int Type, const TFunction<void(const msgpack::object&)>& Callback)
@@ -130,7 +233,103 @@ public:
 
 	S* GetState()
 	{
-		return SerializerInstance->getState();
+		return SerializerInstance ? SerializerInstance->getState() : nullptr;
+	}
+
+	// Writes the decoded state to disk, so a later session can show it before the server's state arrives.
+	bool SaveStateSnapshot(const FString& Path)
+	{
+		if (!SerializerInstance)
+		{
+			return false;
+		}
+
+		std::vector<unsigned char> Encoded;
+		SerializerInstance->snapshot(Encoded);
+		return FFileHelper::SaveArrayToFile(TArrayView<const uint8>(Encoded.data(), Encoded.size()), *Path);
+	}
+
+	// Rebuilds the state from a snapshot written by SaveStateSnapshot(); call it before the room joins and
+	// before registering state callbacks, as a successful load replaces the state object. Snapshots from a
+	// build with a different schema are refused. The server's full state is then reconciled into it, so
+	// only real differences fire callbacks.
+	bool LoadStateSnapshot(const FString& Path)
+	{
+		EnsureSerializer();
+		if (!SerializerInstance)
+		{
+			return false;
+		}
+
+		// Decode straight from a mapped view where the platform supports it, to skip copying the file.
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		TUniquePtr<IMappedFileHandle> MappedFile(PlatformFile.OpenMapped(*Path));
+		TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile ? MappedFile->MapRegion() : nullptr);
+
+		bool bRestored = false;
+		if (MappedRegion)
+		{
+			bRestored = SerializerInstance->restore(MappedRegion->GetMappedPtr(), (int) MappedRegion->GetMappedSize());
+		}
+		else
+		{
+			TArray<uint8> Contents;
+			if (!FFileHelper::LoadFileToArray(Contents, *Path))
+			{
+				return false;
+			}
+			bRestored = SerializerInstance->restore(Contents.GetData(), Contents.Num());
+		}
+
+		if (bRestored)
+		{
+			bHasState = true;
+			DispatchStateChange();
+		}
+		return bRestored;
+	}
+
+	// The traffic, decode and zone counters can be read from any thread; the latency, queue and patch
+	// buffer figures are only consistent when read from the thread that drives the room.
+	RoomStatsSnapshot GetStats() const
+	{
+		RoomStatsSnapshot Snapshot = Stats.Snapshot();
+		Snapshot.ZoneAllocations = MessageZones.GetStats().Allocations;
+		if (ConnectionInstance)
+		{
+			Snapshot.QueueLatencyMicrosP50 = ConnectionInstance->GetQueueLatency().GetPercentile(0.5);
+			Snapshot.QueueLatencyMicrosP99 = ConnectionInstance->GetQueueLatency().GetPercentile(0.99);
+
+			const SendQueueStats Outbound = ConnectionInstance->GetSendQueueStats();
+			Snapshot.QueuedSendBytes = Outbound.QueuedBytes;
+			Snapshot.DroppedSendFrames = Outbound.DroppedFrames;
+			Snapshot.CoalescedSendFrames = Outbound.CoalescedFrames;
+			Snapshot.SendLatencyMicrosP50 = Outbound.SendLatencyMicrosP50;
+			Snapshot.SendLatencyMicrosP99 = Outbound.SendLatencyMicrosP99;
+		}
+		Snapshot.RttMicros = (uint64) (Latency.GetSmoothedRtt() * 1e6);
+		Snapshot.RttJitterMicros = (uint64) (Latency.GetJitter() * 1e6);
+		Snapshot.RttMicrosP99 = Latency.GetRttMicros().GetPercentile(0.99);
+		Snapshot.ClockOffsetMicros = (int64) (Latency.GetClockOffset() * 1e6);
+
+		const PatchJitterBufferStats Buffered = PatchBuffer.GetStats();
+		Snapshot.BufferedPatches = Buffered.BufferedPatches;
+		Snapshot.PatchDelayMicros = (uint64) (Buffered.Delay * 1e6);
+		Snapshot.PatchIntervalMicros = (uint64) (Buffered.Interval * 1e6);
+		Snapshot.LatePatches = Buffered.LatePatches;
+		return Snapshot;
+	}
+
+	void ResetStats()
+	{
+		Stats.Reset();
+		MessageZones.ResetStats();
+	}
+
+	// Phase timestamps of the latest join; complete once OnJoinTraced has run.
+	const JoinTrace& GetJoinTrace() const
+	{
+		return Trace;
 	}
 
 	// Callbacks
@@ -138,11 +337,38 @@ public:
 	TFunction<void(int32 StatusCode)> OnLeave;
 	TFunction<void(int32 StatusCode, const FString& Message)> OnError;
 	TFunction<void(S*)> OnStateChange;
+	// Called once per connection, after the first OnStateChange (or JOIN_ROOM, for rooms without state).
+	TFunction<void(const JoinTrace&)> OnJoinTraced;
 	TMap<const FString, TFunction<void(const msgpack::object&)>> OnMessageHandlers;
 
 	// Properties
 	TSharedPtr<Connection> ConnectionInstance;
 
+	// Zones backing the msgpack::object passed to OnMessage handlers; only valid during the callback.
+	MessageZonePool MessageZones;
+
+	// Creates the connection's transport; the engine WebSocket is used when unset. Set before Connect().
+	TransportFactory CreateTransport;
+
+	// Queue socket events and handle them in Tick() instead of from the socket's callbacks. Set before Connect().
+	// Receiving only happens off the game thread with SocketTransport (see Connection::EnableEventQueue()).
+	bool bQueueNetworkEvents = false;
+
+	// Buffer and pace outbound frames according to OutboundSettings. Set before Connect(). Frames only
+	// queue, coalesce or drop while pacing (OutboundSettings.MaxBytesPerSecond) or a transport backlog
+	// holds them back; see SendQueue.
+	bool bQueueOutbound = false;
+	SendQueueSettings OutboundSettings;
+
+	// Seconds between pings sent from Tick(); 0 disables them.
+	double PingInterval = 0.0;
+
+	// Hold state patches in a jitter buffer and apply them from Tick() at the server's patch rate.
+	// Settings are read on Connect(). ROOM_DATA messages are not buffered, so OnMessage handlers can
+	// run before a patch that arrived ahead of their message has been applied.
+	bool bBufferPatches = false;
+	PatchJitterBufferSettings JitterSettings;
+
 	FString Id;
 	FString Name;
 	FString SessionId;
@@ -150,6 +376,61 @@ public:
 
 protected:
 	bool bHasJoined = false;
+	// A state is already decoded (earlier connection or snapshot), so the next full state is reconciled into it.
+	bool bHasState = false;
+
+	RoomStats Stats;
+	TSharedRef<FrameRecorder> Recorder = MakeShared<FrameRecorder>();
+
+	JoinTrace Trace;
+	bool bTracingJoin = false;
+
+	LatencyEstimator Latency;
+	PatchJitterBuffer PatchBuffer;
+	MessageType PingMessage = MessageType(LatencyEstimator::PingType);
+	double LastPingTime = 0.0;
+	bool bReplaying = false;
+
+	void SendBytes(const void* Bytes, SIZE_T Size, uint32 CoalesceKey = 0, bool bCanDrop = true)
+	{
+		// Replayed frames were answered when they were recorded.
+		if (!ConnectionInstance || bReplaying)
+		{
+			return;
+		}
+
+		Stats.RecordFrameOut(Size);
+		ConnectionInstance->Send(Bytes, Size, CoalesceKey, bCanDrop);
+	}
+
+	void TraceJoin(EJoinPhase Phase)
+	{
+		if (bTracingJoin && !Trace.Has(Phase))
+		{
+			Trace.Mark(Phase);
+		}
+	}
+
+	void FinishJoinTrace()
+	{
+		if (!bTracingJoin)
+		{
+			return;
+		}
+
+		bTracingJoin = false;
+		Trace.RoomId = Id;
+		Trace.RoomName = Name;
+		if (OnJoinTraced)
+		{
+			OnJoinTraced(Trace);
+		}
+	}
+
+	void _onOpen()
+	{
+		TraceJoin(EJoinPhase::SocketOpen);
+	}
 
 	void _onClose(int32 StatusCode, const FString& Reason, bool bWasClean)
 	{
@@ -181,12 +462,14 @@ protected:
 
 		colyseus::schema::Iterator* Iterator = new colyseus::schema::Iterator();
 		Iterator->offset = 0;
+		Iterator->end = Size;
 
 #ifdef COLYSEUS_DEBUG
 		std::cout << "onMessage bytes =>" << Bytes << std::endl;
 #endif
 
 		unsigned char Code = Bytes[Iterator->offset++];
+		Stats.RecordFrameIn(Code, Size);
 
 		switch ((Colyseus::Protocol) Code)
 		{
@@ -198,11 +481,17 @@ protected:
 
 				SerializerId = StdStringToFString(colyseus::schema::decodeString(Bytes, Iterator));
 
-				// TODO: instantiate serializer by id
-				if (Size > Iterator->offset)
+				// Only schema state is decoded; rooms with any other serializer keep no state.
+				if (SerializerId == "schema")
+				{
+					EnsureSerializer();
+				}
+
+				if (SerializerInstance && Size > Iterator->offset)
 				{
 					SerializerInstance->handshake(Bytes, Iterator->offset);
 				}
+				TraceJoin(EJoinPhase::JoinRoom);
 
 				bHasJoined = true;
 				if (OnJoin)
@@ -211,7 +500,13 @@ protected:
 				}
 
 				unsigned char Message[1] = {(int) Colyseus::Protocol::JOIN_ROOM};
-				ConnectionInstance->Send(Message, sizeof(Message));
+				SendBytes(Message, sizeof(Message), 0, false);
+
+				// No state will follow.
+				if (!SerializerInstance)
+				{
+					FinishJoinTrace();
+				}
 				break;
 			}
 			case Colyseus::Protocol::JOIN_ERROR:
@@ -252,6 +547,14 @@ protected:
 					Type = GetMessageHandlerKey(StdStringToFString(colyseus::schema::decodeString(Bytes, Iterator)));
 				}
 
+				Stats.RecordMessageType(Type);
+
+				if (Type == LatencyEstimator::PongType)
+				{
+					HandlePong(Data, Size, Iterator->offset);
+					break;
+				}
+
 				TFunction<void(const msgpack::object&)>* Handler = OnMessageHandlers.Find(Type);
 
 				if (Handler != nullptr)
@@ -259,14 +562,23 @@ protected:
 					if (Size > Iterator->offset)
 					{
 						const char* TheBytes = reinterpret_cast<const char*>(Data);
-						msgpack::object_handle MsgpackObjectHandle = msgpack::unpack(TheBytes, Size, Iterator->offset);
-						msgpack::object MsgpackObject = MsgpackObjectHandle.get();
+						MessageZonePool::ScopedZone Zone(MessageZones);
+						MessageZones.NotePayloadSize(Size - Iterator->offset);
+
+						uint64 DecodeStart = FPlatformTime::Cycles64();
+						msgpack::object MsgpackObject = msgpack::unpack(Zone.Get(), TheBytes, Size, Iterator->offset);
+						Stats.RecordDecode(DecodeStart);
+
+						uint64 DispatchStart = FPlatformTime::Cycles64();
 						(*Handler)(MsgpackObject);
+						Stats.RecordDispatch(DispatchStart);
 					}
 					else
 					{
 						msgpack::object Empty;
+						uint64 DispatchStart = FPlatformTime::Cycles64();
 						(*Handler)(Empty);
+						Stats.RecordDispatch(DispatchStart);
 					}
 				}
 				else
@@ -281,6 +593,8 @@ protected:
 #ifdef COLYSEUS_DEBUG
 				std::cout << "Colyseus.Room: ROOM_STATE" << std::endl;
 #endif
+				// Patches still held were sent before this state; apply them first to keep the order.
+				PatchBuffer.Flush([this](const TArray<uint8>& Patch) { ApplyPatch(Patch.GetData(), 0, Patch.Num()); });
 				SetState(Bytes, Iterator->offset, Size);
 				break;
 			}
@@ -289,7 +603,14 @@ protected:
 #ifdef COLYSEUS_DEBUG
 				std::cout << "Colyseus.Room: ROOM_STATE_PATCH" << std::endl;
 #endif
-				ApplyPatch(Bytes, Iterator->offset, Size);
+				if (bBufferPatches)
+				{
+					PatchBuffer.Push(Bytes + Iterator->offset, Size - Iterator->offset, FPlatformTime::Seconds());
+				}
+				else
+				{
+					ApplyPatch(Bytes, Iterator->offset, Size);
+				}
 				break;
 			}
 			default:
@@ -301,23 +622,96 @@ protected:
 		delete Iterator;
 	}
 
+	// Pong payload: [the ping's local send time, server time in milliseconds]
+	void HandlePong(const void* Data, SIZE_T Size, size_t Offset)
+	{
+		// When the pong arrived, not when a queued event got around to delivering it.
+		const double ReceivedSeconds =
+			FPlatformTime::Seconds() - (ConnectionInstance ? ConnectionInstance->GetDispatchQueueSeconds() : 0.0);
+		if (Size <= Offset)
+		{
+			return;
+		}
+
+		MessageZonePool::ScopedZone Zone(MessageZones);
+		msgpack::object Pong = msgpack::unpack(Zone.Get(), reinterpret_cast<const char*>(Data), Size, Offset);
+
+		auto IsNumber = [](const msgpack::object& Object) {
+			return Object.type == msgpack::type::FLOAT64 || Object.type == msgpack::type::FLOAT32 ||
+				Object.type == msgpack::type::POSITIVE_INTEGER || Object.type == msgpack::type::NEGATIVE_INTEGER;
+		};
+		if (Pong.type != msgpack::type::ARRAY || Pong.via.array.size < 2 || !IsNumber(Pong.via.array.ptr[0]) ||
+			!IsNumber(Pong.via.array.ptr[1]))
+		{
+			return;
+		}
+
+		const double SentSeconds = Pong.via.array.ptr[0].as<double>();
+		const double ServerSeconds = Pong.via.array.ptr[1].as<double>() / 1000.0;
+		Latency.AddSample(SentSeconds, ReceivedSeconds, ServerSeconds);
+	}
+
+	void EnsureSerializer()
+	{
+		if (!SerializerInstance)
+		{
+			SerializerInstance = TSharedPtr<Serializer<S>>(SerializerFactory<S>::create());
+		}
+	}
+
 	void SetState(unsigned const char* Bytes, int Offset, int Length)
 	{
-		SerializerInstance->setState(Bytes, Offset, Length);
+		if (!SerializerInstance)
+		{
+			return;
+		}
 
-		if (OnStateChange)
+		uint64 DecodeStart = FPlatformTime::Cycles64();
+		if (bHasState)
 		{
-			OnStateChange(GetState());
+			SerializerInstance->reconcile(Bytes, Offset, Length);
 		}
+		else
+		{
+			SerializerInstance->setState(Bytes, Offset, Length);
+		}
+		Stats.RecordDecode(DecodeStart);
+		bHasState = true;
+		TraceJoin(EJoinPhase::FirstStateDecoded);
+
+		DispatchStateChange();
 	}
 
 	void ApplyPatch(unsigned const char* Bytes, int Offset, int Length)
 	{
+		if (!SerializerInstance)
+		{
+			return;
+		}
+
+		Stats.RecordPatch(Length - Offset);
+
+		uint64 DecodeStart = FPlatformTime::Cycles64();
 		SerializerInstance->patch(Bytes, Offset, Length);
+		Stats.RecordDecode(DecodeStart);
+
+		DispatchStateChange();
+	}
 
+	void DispatchStateChange()
+	{
 		if (OnStateChange)
 		{
+			uint64 DispatchStart = FPlatformTime::Cycles64();
 			OnStateChange(GetState());
+			Stats.RecordDispatch(DispatchStart);
+		}
+
+		// Only the connection's first full state completes the trace, not a snapshot loaded before it.
+		if (bTracingJoin && Trace.Has(EJoinPhase::FirstStateDecoded))
+		{
+			TraceJoin(EJoinPhase::FirstStateChange);
+			FinishJoinTrace();
 		}
 	}
 
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "MatchMakeHttp.h"
+
+#include <CoreMinimal.h>
+
+#include <nlohmann/json.hpp>
+
+/** One entry of the matchmaker's room list. */
+struct COLYSEUSCLIENT_API RoomListing
+{
+	FString RoomId;
+	FString Name;
+	FString ProcessId;
+	int32 Clients = 0;
+	int32 MaxClients = 0;
+	bool bLocked = false;
+	bool bPrivate = false;
+	nlohmann::json Metadata;
+};
+
+struct COLYSEUSCLIENT_API RoomListingResult
+{
+	bool bSuccess = false;
+	int32 ErrorCode = 0;
+	FString ErrorMessage;
+
+	TArray<RoomListing> Rooms;
+	// Served without a request, or confirmed unchanged by the server (304)
+	bool bFromCache = false;
+};
+
+/**
+ * Room lists per room name, fetched from GET /matchmake/{roomName}. A list younger than the
+ * requested max age is returned without a request. Callers asking while a fetch is running share
+ * it, so many widgets asking at once produce one request. Refreshes send the last ETag so an
+ * unchanged list costs a 304 without a body.
+ * Use it from the game thread.
+ */
+class COLYSEUSCLIENT_API RoomListingCache : public TSharedFromThis<RoomListingCache>
+{
+public:
+	typedef TFunction<void(const RoomListingResult& Result)> ResultHandler;
+
+	// Methods
+
+	/** Url is the full listing URL; RoomName keys the cache. Handler may run before this returns. */
+	void Get(MatchMakeHttp& Http, const FString& Url, const FString& RoomName, double MaxAge, const ResultHandler& Handler);
+
+	/** Drops the cached list for RoomName, or every list when it is empty. */
+	void Invalidate(const FString& RoomName = FString());
+
+	static bool ParseListing(const TArray<uint8>& Content, TArray<RoomListing>& OutRooms, FString& OutError);
+
+	// Properties
+	uint64 Requests = 0;
+	uint64 CacheHits = 0;
+	uint64 NotModified = 0;
+
+private:
+	struct Entry
+	{
+		TArray<RoomListing> Rooms;
+		FString ETag;
+		double FetchedAt = -1.0;
+		bool bInFlight = false;
+		TArray<ResultHandler> Waiters;
+	};
+
+	void Complete(const FString& RoomName, const MatchMakeHttpResponse& Response, bool bWasSuccessful);
+
+	TMap<FString, Entry> Entries;
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <CoreMinimal.h>
+#include <Misc/ScopeRWLock.h>
+
+#include <atomic>
+
+/**
+ * Lock-free histogram with power-of-two buckets, for microsecond timings and byte sizes.
+ * Percentiles resolve to the upper bound of the bucket they fall in.
+ */
+class COLYSEUSCLIENT_API Log2Histogram
+{
+public:
+	static constexpr int32 NumBuckets = 40;
+
+	Log2Histogram();
+
+	void Record(uint64 Value);
+	void Reset();
+
+	uint64 GetCount() const;
+	uint64 GetMax() const;
+	uint64 GetPercentile(double Percentile) const;
+
+private:
+	std::atomic<uint64> Buckets[NumBuckets];
+	std::atomic<uint64> Max;
+};
+
+struct COLYSEUSCLIENT_API RoomStatsSnapshot
+{
+	uint64 BytesIn = 0;
+	uint64 BytesOut = 0;
+	uint64 FramesIn = 0;
+	uint64 FramesOut = 0;
+
+	// Inbound frames per Colyseus::Protocol code
+	TMap<uint8, uint64> ProtocolCounts;
+	// Inbound ROOM_DATA messages per handler key
+	TMap<FString, uint64> MessageTypeCounts;
+
+	uint64 PatchCount = 0;
+	uint64 PatchBytesP50 = 0;
+	uint64 PatchBytesP99 = 0;
+	uint64 PatchBytesMax = 0;
+
+	// Serializer and msgpack decoding, in microseconds
+	uint64 DecodeMicrosP50 = 0;
+	uint64 DecodeMicrosP99 = 0;
+	// OnMessage / OnStateChange callbacks, in microseconds
+	uint64 DispatchMicrosP50 = 0;
+	uint64 DispatchMicrosP99 = 0;
+	// Totals, for CPU time per room
+	uint64 DecodeMicrosTotal = 0;
+	uint64 DispatchMicrosTotal = 0;
+
+	uint64 ZoneAllocations = 0;
+
+	// Time between a frame arriving and Room::Tick() handling it, when events are queued
+	uint64 QueueLatencyMicrosP50 = 0;
+	uint64 QueueLatencyMicrosP99 = 0;
+
+	// Outbound send queue, when enabled
+	int64 QueuedSendBytes = 0;
+	uint64 DroppedSendFrames = 0;
+	uint64 CoalescedSendFrames = 0;
+	uint64 SendLatencyMicrosP50 = 0;
+	uint64 SendLatencyMicrosP99 = 0;
+
+	// Ping round trips, see Room::Ping()
+	uint64 RttMicros = 0;
+	uint64 RttJitterMicros = 0;
+	uint64 RttMicrosP99 = 0;
+	// Server epoch clock minus FPlatformTime::Seconds(); see LatencyEstimator::GetClockOffset()
+	int64 ClockOffsetMicros = 0;
+
+	// Patch jitter buffer, when enabled
+	int32 BufferedPatches = 0;
+	uint64 PatchDelayMicros = 0;
+	uint64 PatchIntervalMicros = 0;
+	uint64 LatePatches = 0;
+};
+
+/**
+ * Per-room traffic and decode counters. Updates use relaxed atomics so they are cheap on the receive
+ * path and can be read from any thread through Snapshot(); Room::GetStats() adds figures that are not.
+ */
+class COLYSEUSCLIENT_API RoomStats
+{
+public:
+	RoomStats();
+
+	// Methods
+	void RecordFrameIn(uint8 Code, SIZE_T Size);
+	void RecordFrameOut(SIZE_T Size);
+	void RecordMessageType(const FString& Type);
+	void RecordPatch(SIZE_T Size);
+	void RecordDecode(uint64 StartCycles);
+	void RecordDispatch(uint64 StartCycles);
+
+	RoomStatsSnapshot Snapshot() const;
+	void Reset();
+
+	static uint64 CyclesToMicros(uint64 Cycles);
+
+private:
+	std::atomic<uint64> BytesIn;
+	std::atomic<uint64> BytesOut;
+	std::atomic<uint64> FramesIn;
+	std::atomic<uint64> FramesOut;
+	std::atomic<uint64> ProtocolCounts[256];
+
+	mutable FRWLock MessageTypeLock;
+	TMap<FString, TUniquePtr<std::atomic<uint64>>> MessageTypeCounts;
+
+	Log2Histogram PatchBytes;
+	Log2Histogram DecodeMicros;
+	Log2Histogram DispatchMicros;
+	std::atomic<uint64> DecodeMicrosTotal;
+	std::atomic<uint64> DispatchMicrosTotal;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "RoomStats.h"
+
+#include <CoreMinimal.h>
+
+enum class ESendOverflowPolicy : uint8
+{
+	// Reject the frame being sent
+	DropNewest,
+	// Evict the oldest droppable frames until the new one fits
+	DropOldest,
+};
+
+struct COLYSEUSCLIENT_API SendQueueSettings
+{
+	// Droppable frames are evicted or rejected past this many queued bytes
+	int64 MaxQueuedBytes = 64 * 1024;
+	// Outbound budget; 0 sends everything as soon as it is flushed
+	int64 MaxBytesPerSecond = 0;
+	ESendOverflowPolicy OverflowPolicy = ESendOverflowPolicy::DropOldest;
+	// Stop flushing while the transport reports more than this many unsent bytes; 0 ignores it.
+	// SocketTransport and LoopbackTransport report their backlog. The engine WebSocket exposes none,
+	// so with WebSocketTransport only MaxBytesPerSecond holds frames back.
+	int64 MaxTransportBufferedBytes = 16 * 1024;
+};
+
+struct COLYSEUSCLIENT_API SendQueueStats
+{
+	int64 QueuedBytes = 0;
+	int32 QueuedFrames = 0;
+	uint64 DroppedFrames = 0;
+	uint64 CoalescedFrames = 0;
+	// Time from Send() to the frame reaching the socket, in microseconds
+	uint64 SendLatencyMicrosP50 = 0;
+	uint64 SendLatencyMicrosP99 = 0;
+};
+
+/**
+ * Outbound frames waiting for the link. Frames sharing a non-zero coalesce key replace each
+ * other in place (only the latest is sent), and a token bucket paces how fast frames leave.
+ *
+ * Frames only wait while something holds them back: MaxBytesPerSecond, or a transport backlog over
+ * MaxTransportBufferedBytes. With neither, every frame is flushed as it is sent, so coalescing and
+ * the overflow policy never engage.
+ * Not thread-safe: use it from the thread that sends.
+ */
+class COLYSEUSCLIENT_API SendQueue
+{
+public:
+	SendQueue(const SendQueueSettings& Settings);
+
+	// Methods
+	void Enqueue(const void* Data, SIZE_T Size, uint32 CoalesceKey, bool bCanDrop);
+
+	/**
+	 * Passes frames the budget allows to Writer, oldest first, stopping before MaxBytes would be
+	 * exceeded. Returns how many were written.
+	 */
+	int32 Flush(const TFunction<void(const void* Data, SIZE_T Size)>& Writer, int64 MaxBytes = MAX_int64);
+
+	SendQueueStats GetStats() const;
+
+	inline bool IsEmpty() const
+	{
+		return Frames.Num() == 0;
+	}
+
+	// Properties
+	SendQueueSettings Settings;
+
+private:
+	struct Frame
+	{
+		TArray<uint8> Bytes;
+		uint32 CoalesceKey;
+		bool bCanDrop;
+		uint64 EnqueuedCycles;
+	};
+
+	void Evict(int64 BytesNeeded);
+
+	TArray<Frame> Frames;
+	int64 QueuedBytes = 0;
+
+	double Tokens;
+	double LastRefillTime;
+
+	uint64 DroppedFrames = 0;
+	uint64 CoalescedFrames = 0;
+	Log2Histogram SendLatencyMicros;
+};
@@ -4,6 +4,41 @@
 #include "schema.h"
 #include "Serializer.hpp"
 
+namespace colyseus
+{
+namespace schema
+{
+static const unsigned char SNAPSHOT_MAGIC[4] = {'C', 'Y', 'S', 'S'};
+static const unsigned char SNAPSHOT_VERSION = 3;
+// Magic, version, payload length, payload checksum and schema layout hash
+static const int SNAPSHOT_HEADER_SIZE = 17;
+
+// 32-bit FNV-1a over the snapshot payload
+inline uint32_t snapshotChecksum(unsigned const char* bytes, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+inline void writeSnapshotUint32(unsigned char* bytes, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        bytes[i] = (unsigned char) (value >> (8 * i));
+    }
+}
+
+inline uint32_t readSnapshotUint32(unsigned const char* bytes)
+{
+    return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+} // namespace schema
+} // namespace colyseus
+
 template <typename S>
 class SchemaSerializer : public Serializer<S>
 {
@@ -23,20 +58,98 @@ public:
 
     void setState(unsigned const char* bytes, int offset, int length) {
         it->offset = offset;
+        it->overflow = false;
         ((colyseus::schema::Schema*)state)->decode(bytes, length, it);
     }
 
     void patch(unsigned const char* bytes, int offset, int length) {
         it->offset = offset;
+        it->overflow = false;
         ((colyseus::schema::Schema*)state)->decode(bytes, length, it);
     }
 
+    // Decodes through its own iterator, so the reconcile flag cannot outlive this call if decode() throws.
+    void reconcile(unsigned const char* bytes, int offset, int length) {
+        colyseus::schema::Iterator reconciling;
+        reconciling.offset = offset;
+        reconciling.reconcile = true;
+        ((colyseus::schema::Schema*)state)->decode(bytes, length, &reconciling);
+        it->offset = reconciling.offset;
+        it->overflow = reconciling.overflow;
+    }
+
     void handshake(unsigned const char* bytes, int offset) {
         // TODO: validate incoming schema with Reflection.
     }
 
+    // Snapshot layout: "CYSS", format version, little-endian uint32 payload length, payload checksum and
+    // Schema::layoutHash() of S, then the state re-encoded as a full ROOM_STATE body.
+    void snapshot(std::vector<unsigned char>& bytes) {
+        using namespace colyseus::schema;
+        size_t header = bytes.size();
+        bytes.insert(bytes.end(), SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + 4);
+        bytes.push_back(SNAPSHOT_VERSION);
+        bytes.resize(header + SNAPSHOT_HEADER_SIZE);
+        ((colyseus::schema::Schema*)state)->encode(bytes);
+
+        size_t payload = header + SNAPSHOT_HEADER_SIZE;
+        size_t payloadLength = bytes.size() - payload;
+        writeSnapshotUint32(&bytes[header + 5], (uint32_t) payloadLength);
+        writeSnapshotUint32(&bytes[header + 9], snapshotChecksum(&bytes[payload], payloadLength));
+        writeSnapshotUint32(&bytes[header + 13], ((colyseus::schema::Schema*)state)->layoutHash());
+    }
+
+    // Refuses snapshots whose header, length, checksum or schema layout does not match; decoding never
+    // reads past length. The snapshot is decoded into a fresh state, which replaces the current one only
+    // if decoding succeeds, so callbacks registered on the previous state are not carried over.
+    bool restore(unsigned const char* bytes, int length) {
+        using namespace colyseus::schema;
+        if (length < SNAPSHOT_HEADER_SIZE || std::memcmp(bytes, SNAPSHOT_MAGIC, 4) != 0 || bytes[4] != SNAPSHOT_VERSION) {
+            return false;
+        }
+
+        size_t payloadLength = (size_t) length - SNAPSHOT_HEADER_SIZE;
+        if (readSnapshotUint32(bytes + 5) != payloadLength ||
+            readSnapshotUint32(bytes + 9) != snapshotChecksum(bytes + SNAPSHOT_HEADER_SIZE, payloadLength) ||
+            readSnapshotUint32(bytes + 13) != ((colyseus::schema::Schema*)state)->layoutHash()) {
+            return false;
+        }
+
+        S* restored = new S();
+        Iterator restoring;
+        restoring.offset = SNAPSHOT_HEADER_SIZE;
+        try {
+            ((colyseus::schema::Schema*)restored)->decode(bytes, length, &restoring);
+        } catch (const std::exception&) {
+            delete restored;
+            return false;
+        }
+
+        if (restoring.overflow) {
+            delete restored;
+            return false;
+        }
+
+        delete state;
+        state = restored;
+        return true;
+    }
+
     void teardown() {
     }
 };
 
+template <typename S>
+struct SerializerFactory
+{
+    static Serializer<S>* create() { return new SchemaSerializer<S>(); }
+};
+
+// Rooms without a typed state never decode one.
+template <>
+struct SerializerFactory<void>
+{
+    static Serializer<void>* create() { return nullptr; }
+};
+
 #endif /* SchemaSerializer_hpp */
@@ -3,18 +3,25 @@
 
 #include "schema.h"
 
+#include <vector>
+
 template <typename S>
 class Serializer
 {
 public:
-//    Serializer();
-//    virtual ~Serializer();
+    virtual ~Serializer() = default;
 
     virtual S* getState() = 0;
     virtual void setState(unsigned const char* bytes, int offset, int length) = 0;
     virtual void patch(unsigned const char* bytes, int offset, int length) = 0;
+    // Applies a full state on top of the current one, only reporting what differs.
+    virtual void reconcile(unsigned const char* bytes, int offset, int length) { setState(bytes, offset, length); }
     virtual void teardown() = 0;
     virtual void handshake(unsigned const char* bytes, int offset) = 0;
+
+    // Local snapshots of the decoded state, see SchemaSerializer
+    virtual void snapshot(std::vector<unsigned char>& bytes) = 0;
+    virtual bool restore(unsigned const char* bytes, int length) = 0;
 };
 
 #endif /* Serializer_hpp */
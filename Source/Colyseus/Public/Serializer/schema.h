@@ -9,11 +9,13 @@
 #include <iostream>
 #include <stdint.h>
 
+#include <bitset>
 #include <cstring>
 #include <functional>
 #include <vector>
 #include <string>
 #include <map>
+#include <set>
 
 #include <typeinfo>
 #include <typeindex>
@@ -40,6 +42,12 @@ enum class SPEC : unsigned char
 struct Iterator
 {
     size_t offset = 0;
+    // Reads stop at end; one that would pass it sets overflow, moves offset to end and yields 0.
+    size_t end = SIZE_MAX;
+    bool overflow = false;
+    // Decoding a full state onto an existing tree: only differences trigger callbacks,
+    // and map items missing from the new state are removed.
+    bool reconcile = false;
 };
 
 // template <typename T>
@@ -76,8 +84,20 @@ inline bool IsLittleEndian()
     return (int)*((unsigned char *)&i) == 1;
 }
 
+inline bool canRead(Iterator *it, size_t count)
+{
+    if (it->offset > it->end || count > it->end - it->offset)
+    {
+        it->offset = it->end;
+        it->overflow = true;
+        return false;
+    }
+    return true;
+}
+
 inline string decodeString(unsigned const char bytes[], Iterator *it)
 {
+    if (!canRead(it, 1)) { return string(); }
     unsigned char prefix = bytes[it->offset++];
     unsigned int length = 0;
 
@@ -98,6 +118,8 @@ inline string decodeString(unsigned const char bytes[], Iterator *it)
         length = decodeUint32(bytes, it);
     }
 
+    if (!canRead(it, length)) { return string(); }
+
     char * str = new char[length + 1];
     std::memcpy(str, bytes + it->offset, length);
     str[length] = '\0'; // string termination
@@ -110,16 +132,19 @@ inline string decodeString(unsigned const char bytes[], Iterator *it)
 
 inline int8_t decodeInt8(unsigned const char bytes[], Iterator *it)
 {
+    if (!canRead(it, 1)) { return 0; }
     return (int8_t)(bytes[it->offset++] << 24 >> 24);
 }
 
 inline uint8_t decodeUint8(unsigned const char bytes[], Iterator *it)
 {
+    if (!canRead(it, 1)) { return 0; }
     return (uint8_t)bytes[it->offset++];
 }
 
 inline int16_t decodeInt16(unsigned const char bytes[], Iterator *it)
 {
+    if (!canRead(it, 2)) { return 0; }
     int16_t value = *(int16_t *)&bytes[it->offset];
     it->offset += 2;
     return value;
@@ -127,6 +152,7 @@ inline int16_t decodeInt16(unsigned const char bytes[], Iterator *it)
 
 inline uint16_t decodeUint16(unsigned const char bytes[], Iterator *it)
 {
+    if (!canRead(it, 2)) { return 0; }
     uint16_t value = *(uint16_t *)&bytes[it->offset];
     it->offset += 2;
     return value;
@@ -134,6 +160,7 @@ inline uint16_t decodeUint16(unsigned const char bytes[], Iterator *it)
 
 inline int32_t decodeInt32(unsigned const char bytes[], Iterator *it)
 {
+    if (!canRead(it, 4)) { return 0; }
     int32_t value = *(int32_t *)&bytes[it->offset];
     it->offset += 4;
     return value;
@@ -141,6 +168,7 @@ inline int32_t decodeInt32(unsigned const char bytes[], Iterator *it)
 
 inline uint32_t decodeUint32(unsigned const char bytes[], Iterator *it)
 {
+    if (!canRead(it, 4)) { return 0; }
     uint32_t value = *(uint32_t *)&bytes[it->offset];
     it->offset += 4;
     return value;
@@ -148,6 +176,7 @@ inline uint32_t decodeUint32(unsigned const char bytes[], Iterator *it)
 
 inline int64_t decodeInt64(unsigned const char bytes[], Iterator *it)
 {
+    if (!canRead(it, 8)) { return 0; }
     int64_t value = *(int64_t *)&bytes[it->offset];
     it->offset += 8;
     return value;
@@ -155,6 +184,7 @@ inline int64_t decodeInt64(unsigned const char bytes[], Iterator *it)
 
 inline uint64_t decodeUint64(unsigned const char bytes[], Iterator *it)
 {
+    if (!canRead(it, 8)) { return 0; }
     uint64_t value = *(uint64_t *)&bytes[it->offset];
     it->offset += 8;
     return value;
@@ -162,6 +192,7 @@ inline uint64_t decodeUint64(unsigned const char bytes[], Iterator *it)
 
 inline float32_t decodeFloat32(unsigned const char bytes[], Iterator *it)
 {
+    if (!canRead(it, 4)) { return 0; }
     float32_t value = *(float32_t *)&bytes[it->offset];
     it->offset += 4;
     return value;
@@ -169,6 +200,7 @@ inline float32_t decodeFloat32(unsigned const char bytes[], Iterator *it)
 
 inline float64_t decodeFloat64(unsigned const char bytes[], Iterator *it)
 {
+    if (!canRead(it, 8)) { return 0; }
     float64_t value = *(float64_t *)&bytes[it->offset];
     it->offset += 8;
     return value;
@@ -176,6 +208,7 @@ inline float64_t decodeFloat64(unsigned const char bytes[], Iterator *it)
 
 inline varint_t decodeNumber(unsigned const char bytes[], Iterator *it)
 {
+    if (!canRead(it, 1)) { return 0; }
     auto prefix = bytes[it->offset++];
 #ifdef COLYSEUS_DEBUG
     std::cout << "decodeNumber, prefix => " << ((int)prefix) << std::endl;
@@ -254,22 +287,95 @@ inline bool decodeBoolean(unsigned const char bytes[], Iterator *it)
 
 inline bool numberCheck(unsigned const char bytes[], Iterator *it)
 {
+    if (it->offset >= it->end) { return false; }
     auto prefix = bytes[it->offset];
     return (prefix < 0x80 || (prefix >= 0xca && prefix <= 0xd3));
 }
 
 inline bool arrayCheck (unsigned const char bytes[], Iterator *it) {
+  if (it->offset >= it->end) { return false; }
   return bytes[it->offset] < 0xa0;
 }
 
 inline bool nilCheck(unsigned const char bytes[], Iterator *it) {
+  if (it->offset >= it->end) { return false; }
   return bytes[it->offset] == (unsigned char) SPEC::NIL;
 }
 
 inline bool indexChangeCheck(unsigned const char bytes[], Iterator *it) {
+  if (it->offset >= it->end) { return false; }
   return bytes[it->offset] == (unsigned char) SPEC::INDEX_CHANGE;
 }
 
+// Encoders mirror the decoders above: fixed-size values are written in native
+// (little-endian) byte order, like @colyseus/schema does.
+template <typename T>
+inline void encodeRaw(std::vector<unsigned char> &bytes, T value)
+{
+    const unsigned char *raw = (const unsigned char *)&value;
+    bytes.insert(bytes.end(), raw, raw + sizeof(T));
+}
+
+inline void encodeString(std::vector<unsigned char> &bytes, const char *value, size_t length)
+{
+    if (length < 0x20)
+    {
+        bytes.push_back((unsigned char)(length | 0xa0));
+    }
+    else if (length < 0x100)
+    {
+        bytes.push_back(0xd9);
+        encodeRaw<uint8_t>(bytes, (uint8_t)length);
+    }
+    else if (length < 0x10000)
+    {
+        bytes.push_back(0xda);
+        encodeRaw<uint16_t>(bytes, (uint16_t)length);
+    }
+    else
+    {
+        bytes.push_back(0xdb);
+        encodeRaw<uint32_t>(bytes, (uint32_t)length);
+    }
+
+    bytes.insert(bytes.end(), (const unsigned char *)value, (const unsigned char *)value + length);
+}
+
+inline void encodeString(std::vector<unsigned char> &bytes, const string &value)
+{
+    encodeString(bytes, value.data(), value.size());
+}
+
+inline void encodeNumber(std::vector<unsigned char> &bytes, double value)
+{
+    if (value != value || value >= 9.2e18 || value <= -9.2e18 || (double)(int64_t)value != value)
+    {
+        // NaN, fractional or out of int64 range
+        bytes.push_back(0xcb);
+        encodeRaw<float64_t>(bytes, value);
+        return;
+    }
+
+    int64_t number = (int64_t)value;
+
+    if (number >= 0)
+    {
+        if (number < 0x80)              { bytes.push_back((unsigned char)number); }
+        else if (number < 0x100)        { bytes.push_back(0xcc); encodeRaw<uint8_t>(bytes, (uint8_t)number); }
+        else if (number < 0x10000)      { bytes.push_back(0xcd); encodeRaw<uint16_t>(bytes, (uint16_t)number); }
+        else if (number < 0x100000000)  { bytes.push_back(0xce); encodeRaw<uint32_t>(bytes, (uint32_t)number); }
+        else                            { bytes.push_back(0xcf); encodeRaw<uint64_t>(bytes, (uint64_t)number); }
+    }
+    else
+    {
+        if (number >= -0x20)            { bytes.push_back((unsigned char)(0xe0 | (number + 0x20))); }
+        else if (number >= -0x80)       { bytes.push_back(0xd0); encodeRaw<int8_t>(bytes, (int8_t)number); }
+        else if (number >= -0x8000)     { bytes.push_back(0xd1); encodeRaw<int16_t>(bytes, (int16_t)number); }
+        else if (number >= -0x80000000LL) { bytes.push_back(0xd2); encodeRaw<int32_t>(bytes, (int32_t)number); }
+        else                            { bytes.push_back(0xd3); encodeRaw<int64_t>(bytes, number); }
+    }
+}
+
 template <typename T>
 class ArraySchema
 {
@@ -355,7 +461,7 @@ class MapSchema
         }
 
 #ifdef COLYSEUS_DEBUG
-        for (tsl::ordered_map<string, char *>::iterator it = this->items.begin(); it != this->items.end(); ++it)
+        for (auto it = this->items.begin(); it != this->items.end(); ++it)
         {
             std::cout << "MAP, PREVIOUS KEY => " << it->first << std::endl;
         }
@@ -404,17 +510,23 @@ class Schema
         array.setAt(index, decoder(bytes, it));
     }
 
-    inline void decode(unsigned const char bytes[], int totalBytes, Iterator *it = nullptr) //new Iterator())
+    // Returns whether anything in this structure changed.
+    inline bool decode(unsigned const char bytes[], int totalBytes, Iterator *it = nullptr) //new Iterator())
     {
         bool doesOwnIterator = it == nullptr;
         if (doesOwnIterator) it = new Iterator();
+        it->end = (size_t) totalBytes;
 
         std::vector<DataChange> changes;
+        bool anyChange = false;
+        // Only tracked while reconciling, to find the fields a full state left out.
+        std::bitset<256> decodedFields;
 
         while (it->offset < totalBytes)
         {
             bool isNil = nilCheck(bytes, it);
             if (isNil) { it->offset++; }
+            if (!canRead(it, 1)) { break; }
 
             unsigned char index = (unsigned char) bytes[it->offset++];
 #ifdef COLYSEUS_DEBUG
@@ -429,6 +541,7 @@ class Schema
             // TODO: for backwards compatibility, check existance of field before calling .at()
             string field = this->_indexes.at(index);
             string type = this->_types.at(index);
+            if (it->reconcile) { decodedFields.set(index); }
 
             bool hasChange = false;
 
@@ -439,14 +552,20 @@ class Schema
             else if (type == "ref")
             {
                 Schema* value = this->getRef(field);
+                bool isNew = value == nullptr;
 
-                if (value == nullptr) {
+                if (isNew) {
                     auto childType = this->_childSchemaTypes.at(index);
                     value = this->createInstance(childType);
+                    this->setRef(field, value);
                 }
 
-                value->decode(bytes, totalBytes, it);
-                hasChange = true;
+                bool wasReconciling = it->reconcile;
+                if (isNew) { it->reconcile = false; }
+                bool childChanged = value->decode(bytes, totalBytes, it);
+                it->reconcile = wasReconciling;
+
+                hasChange = !it->reconcile || isNew || childChanged;
 
             }
             else if (type == "array")
@@ -457,10 +576,16 @@ class Schema
                 int newLength = decodeNumber(bytes, it);
                 int numChanges = decodeNumber(bytes, it);
 
-                bool hasRemoval = (value->items.size() > newLength);
-                hasChange = (numChanges > 0) || hasRemoval;
-
                 bool isSchemaType = this->_childSchemaTypes.find(index) != this->_childSchemaTypes.end();
+                // Primitive arrays hold their items by value, so they are only accessed through their real type.
+                string primitiveType = isSchemaType ? string() : this->_childPrimitiveTypes.at(index);
+
+                int previousLength = 0;
+                visitArray(primitiveType, valueRef, [&](auto *typed) { previousLength = (int) typed->items.size(); });
+
+                bool hasRemoval = (previousLength > newLength);
+                hasChange = (numChanges > 0) || hasRemoval;
+                bool anyItemChanged = false;
 
                 // FIXME: this may not be reliable. possibly need to encode this variable during
                 // serializagion
@@ -468,18 +593,17 @@ class Schema
 
                 // ensure current array has the same length as encoded one
                 if (hasRemoval) {
-                    for (int i = newLength; i < value->items.size(); i++)
-                    {
-                        if (isSchemaType && ((Schema*)value->items[i])->onRemove)
+                    visitArray(primitiveType, valueRef, [&](auto *typed) {
+                        for (int i = newLength; i < (int) typed->items.size(); i++)
                         {
-                            ((Schema *)value->items[i])->onRemove();
+                            notifyItemRemoved(typed->items[i]);
+                            if (typed->onRemove)
+                            {
+                                typed->onRemove(typed->items[i], i);
+                            }
                         }
-                        if (valueRef->onRemove)
-                        {
-                            valueRef->onRemove(value->items[i], i);
-                        }
-                    }
-                    value->items.resize(newLength);
+                        typed->items.resize(newLength);
+                    });
                 }
 
                 for (int i = 0; i < numChanges; i++)
@@ -499,7 +623,11 @@ class Schema
 
                     }
 
-                    bool isNew = (!hasIndexChange && !value->has(newIndex)) || (hasIndexChange && indexChangedFrom == -1);
+                    bool hasIndex = false;
+                    visitArray(primitiveType, valueRef, [&](auto *typed) { hasIndex = typed->has(newIndex); });
+
+                    bool isNew = (!hasIndexChange && !hasIndex) || (hasIndexChange && indexChangedFrom == -1);
+                    bool itemChanged = true;
 
                     if (isSchemaType)
                     {
@@ -524,47 +652,58 @@ class Schema
                             isNew = true;
                         }
 
-                        ((Schema*) item)->decode(bytes, totalBytes, it);
+                        bool wasReconciling = it->reconcile;
+                        if (isNew) { it->reconcile = false; }
+                        itemChanged = ((Schema*) item)->decode(bytes, totalBytes, it) || isNew;
+                        it->reconcile = wasReconciling;
+
                         value->setAt(newIndex, item);
                     }
                     else
                     {
                         // FIXME: this is ugly and repetitive
-                        string primitiveType = this->_childPrimitiveTypes.at(index);
-
-                        if (primitiveType == "string")       { ((ArraySchema<string> *)value)->setAt(newIndex, decodeString(bytes, it)); }
-                        else if (primitiveType == "number")  { ((ArraySchema<varint_t> *)value)->setAt(newIndex, decodeNumber(bytes, it)); }
-                        else if (primitiveType == "boolean") { ((ArraySchema<bool> *)value)->setAt(newIndex, decodeBoolean(bytes, it)); }
-                        else if (primitiveType == "int8")    { ((ArraySchema<int8_t> *)value)->setAt(newIndex, decodeInt8(bytes, it)); }
-                        else if (primitiveType == "uint8")   { ((ArraySchema<uint8_t> *)value)->setAt(newIndex, decodeUint8(bytes, it)); }
-                        else if (primitiveType == "int16")   { ((ArraySchema<int16_t> *)value)->setAt(newIndex, decodeInt16(bytes, it)); }
-                        else if (primitiveType == "uint16")  { ((ArraySchema<uint16_t> *)value)->setAt(newIndex, decodeUint16(bytes, it)); }
-                        else if (primitiveType == "int32")   { ((ArraySchema<int32_t> *)value)->setAt(newIndex, decodeInt32(bytes, it)); }
-                        else if (primitiveType == "uint32")  { ((ArraySchema<uint32_t> *)value)->setAt(newIndex, decodeUint32(bytes, it)); }
-                        else if (primitiveType == "int64")   { ((ArraySchema<int64_t> *)value)->setAt(newIndex, decodeInt64(bytes, it)); }
-                        else if (primitiveType == "uint64")  { ((ArraySchema<uint64_t> *)value)->setAt(newIndex, decodeUint64(bytes, it)); }
-                        else if (primitiveType == "float32") { ((ArraySchema<float32_t> *)value)->setAt(newIndex, decodeFloat32(bytes, it)); }
-                        else if (primitiveType == "float64") { ((ArraySchema<float64_t> *)value)->setAt(newIndex, decodeFloat64(bytes, it)); }
+                        if (primitiveType == "string")       { itemChanged = setArrayItem<string>(value, newIndex, decodeString(bytes, it)); }
+                        else if (primitiveType == "number")  { itemChanged = setArrayItem<varint_t>(value, newIndex, decodeNumber(bytes, it)); }
+                        else if (primitiveType == "boolean") { itemChanged = setArrayItem<bool>(value, newIndex, decodeBoolean(bytes, it)); }
+                        else if (primitiveType == "int8")    { itemChanged = setArrayItem<int8_t>(value, newIndex, decodeInt8(bytes, it)); }
+                        else if (primitiveType == "uint8")   { itemChanged = setArrayItem<uint8_t>(value, newIndex, decodeUint8(bytes, it)); }
+                        else if (primitiveType == "int16")   { itemChanged = setArrayItem<int16_t>(value, newIndex, decodeInt16(bytes, it)); }
+                        else if (primitiveType == "uint16")  { itemChanged = setArrayItem<uint16_t>(value, newIndex, decodeUint16(bytes, it)); }
+                        else if (primitiveType == "int32")   { itemChanged = setArrayItem<int32_t>(value, newIndex, decodeInt32(bytes, it)); }
+                        else if (primitiveType == "uint32")  { itemChanged = setArrayItem<uint32_t>(value, newIndex, decodeUint32(bytes, it)); }
+                        else if (primitiveType == "int64")   { itemChanged = setArrayItem<int64_t>(value, newIndex, decodeInt64(bytes, it)); }
+                        else if (primitiveType == "uint64")  { itemChanged = setArrayItem<uint64_t>(value, newIndex, decodeUint64(bytes, it)); }
+                        else if (primitiveType == "float32") { itemChanged = setArrayItem<float32_t>(value, newIndex, decodeFloat32(bytes, it)); }
+                        else if (primitiveType == "float64") { itemChanged = setArrayItem<float64_t>(value, newIndex, decodeFloat64(bytes, it)); }
                         else { throw std::invalid_argument("cannot decode invalid type: " + primitiveType); }
                     }
 
-                    if (isNew)
-                    {
-                        if (valueRef->onAdd)
+                    anyItemChanged = anyItemChanged || itemChanged;
+
+                    visitArray(primitiveType, valueRef, [&](auto *typed) {
+                        if (isNew)
                         {
-                            valueRef->onAdd(value->items.at(newIndex), newIndex);
+                            if (typed->onAdd)
+                            {
+                                typed->onAdd(typed->items.at(newIndex), newIndex);
+                            }
                         }
-                    }
-                    else if (valueRef->onChange)
-                    {
-                        valueRef->onChange(value->items.at(newIndex), newIndex);
-                    }
+                        else if (typed->onChange && (!it->reconcile || itemChanged))
+                        {
+                            typed->onChange(typed->items.at(newIndex), newIndex);
+                        }
+                    });
+
+                }
 
+                if (it->reconcile)
+                {
+                    hasChange = anyItemChanged || hasRemoval;
                 }
 
                 this->setArray(field, value);
 #ifdef COLYSEUS_DEBUG
-                std::cout << "array set successfully! size => " << value->size() << std::endl;
+                std::cout << "array set successfully! size => " << newLength << std::endl;
 #endif
             }
             else if (type == "map")
@@ -589,12 +728,18 @@ class Schema
                 std::cout << "MAP, IS SCHEMA TYPE? => " << isSchemaType << std::endl;
 #endif
 
+                // Primitive maps hold their items by value, so they are only accessed through their real type.
+                string primitiveType = isSchemaType ? string() : this->_childPrimitiveTypes.at(index);
+
                 // List of previous keys
-                std::vector<string> previousKeys = valueRef->keys();
+                std::vector<string> previousKeys;
+                visitMap(primitiveType, valueRef, [&](auto *typed) { previousKeys = typed->keys(); });
+                std::set<string> decodedKeys;
+                bool anyItemChanged = false;
 
                 for (int i = 0; i < length; i++)
                 {
-                    if (it->offset > totalBytes || bytes[it->offset] == (unsigned char)SPEC::END_OF_STRUCTURE)
+                    if (it->offset >= it->end || bytes[it->offset] == (unsigned char)SPEC::END_OF_STRUCTURE)
                     {
 #ifdef COLYSEUS_DEBUG
                         std::cout << "MAP: END OF STRUCTURE!" << std::endl;
@@ -608,13 +753,13 @@ class Schema
                     string previousKey = "";
                     if (indexChangeCheck(bytes, it)) {
                         it->offset++;
-                        previousKey = previousKeys[decodeNumber(bytes, it)];
+                        previousKey = previousKeys.at((size_t) decodeNumber(bytes, it));
                         hasIndexChange = true;
                     }
 
                     bool hasMapIndex = numberCheck(bytes, it);
                     string newKey = (hasMapIndex)
-                        ? previousKeys[decodeNumber(bytes, it)]
+                        ? previousKeys.at((size_t) decodeNumber(bytes, it))
                         : decodeString(bytes, it);
 
 #ifdef COLYSEUS_DEBUG
@@ -622,24 +767,29 @@ class Schema
                     std::cout << "newKey => " << newKey << std::endl;
 #endif
 
+                    bool hasKey = false;
+                    visitMap(primitiveType, valueRef, [&](auto *typed) { hasKey = typed->has(newKey); });
+
                     char* item = nullptr;
-                    bool isNew = (!hasIndexChange && !valueRef->has(newKey)) || (hasIndexChange && previousKey == "" && hasMapIndex);
+                    bool isNew = (!hasIndexChange && !hasKey) || (hasIndexChange && previousKey == "" && hasMapIndex);
+                    bool itemChanged = true;
 
 #ifdef COLYSEUS_DEBUG
                     std::cout << "isNew => " << isNew << std::endl;
 #endif
 
-                    if (isNew && isSchemaType)
+                    if (isSchemaType)
                     {
-                        item = (char*) this->createInstance(this->_childSchemaTypes.at(index));
+                        if (isNew)
+                        {
+                            item = (char*) this->createInstance(this->_childSchemaTypes.at(index));
 
-                    } else if (previousKey != "")
-                    {
-                        item = valueRef->at(previousKey);
+                        } else if (previousKey != "")
+                        {
+                            item = valueRef->at(previousKey);
 
-                    } else
-                    {
-                        if (valueRef->has(newKey)) {
+                        } else if (hasKey)
+                        {
                             item = valueRef->at(newKey);
                         }
                     }
@@ -651,57 +801,116 @@ class Schema
                             ((Schema *)item)->onRemove();
                         }
 
-                        if (valueRef->onRemove) {
-                            valueRef->onRemove(item, newKey);
-                        }
-
-                        value->items.erase(newKey);
+                        visitMap(primitiveType, valueRef, [&](auto *typed) {
+                            if (typed->onRemove && typed->has(newKey)) {
+                                typed->onRemove(typed->items.at(newKey), newKey);
+                            }
+                            typed->items.erase(newKey);
+                        });
+                        anyItemChanged = true;
                         continue;
 
                     } else if (!isSchemaType)
                     {
-                        string primitiveType = this->_childPrimitiveTypes.at(index);
-
                         // FIXME: this is ugly and repetitive
-                        if (primitiveType == "string")       {((MapSchema<string> *)value)->items[newKey] = decodeString(bytes, it); }
-                        else if (primitiveType == "number")  {((MapSchema<varint_t> *)value)->items[newKey] = decodeNumber(bytes, it); }
-                        else if (primitiveType == "boolean") { ((MapSchema<bool> *)value)->items[newKey] = decodeBoolean(bytes, it) ; }
-                        else if (primitiveType == "int8")    { ((MapSchema<int8_t> *)value)->items[newKey] = decodeInt8(bytes, it) ; }
-                        else if (primitiveType == "uint8")   { ((MapSchema<uint8_t> *)value)->items[newKey] = decodeUint8(bytes, it) ; }
-                        else if (primitiveType == "int16")   { ((MapSchema<int16_t> *)value)->items[newKey] = decodeInt16(bytes, it) ; }
-                        else if (primitiveType == "uint16")  { ((MapSchema<uint16_t> *)value)->items[newKey] = decodeUint16(bytes, it) ; }
-                        else if (primitiveType == "int32")   { ((MapSchema<int32_t> *)value)->items[newKey] = decodeInt32(bytes, it) ; }
-                        else if (primitiveType == "uint32")  { ((MapSchema<uint32_t> *)value)->items[newKey] = decodeUint32(bytes, it) ; }
-                        else if (primitiveType == "int64")   { ((MapSchema<int64_t> *)value)->items[newKey] = decodeInt64(bytes, it) ; }
-                        else if (primitiveType == "uint64")  { ((MapSchema<uint64_t> *)value)->items[newKey] = decodeUint64(bytes, it) ; }
-                        else if (primitiveType == "float32") { ((MapSchema<float32_t> *)value)->items[newKey] = decodeFloat32(bytes, it) ; }
-                        else if (primitiveType == "float64") { ((MapSchema<float64_t> *)value)->items[newKey] = decodeFloat64(bytes, it) ; }
+                        if (primitiveType == "string")       { itemChanged = setMapItem<string>(value, newKey, decodeString(bytes, it)); }
+                        else if (primitiveType == "number")  { itemChanged = setMapItem<varint_t>(value, newKey, decodeNumber(bytes, it)); }
+                        else if (primitiveType == "boolean") { itemChanged = setMapItem<bool>(value, newKey, decodeBoolean(bytes, it)); }
+                        else if (primitiveType == "int8")    { itemChanged = setMapItem<int8_t>(value, newKey, decodeInt8(bytes, it)); }
+                        else if (primitiveType == "uint8")   { itemChanged = setMapItem<uint8_t>(value, newKey, decodeUint8(bytes, it)); }
+                        else if (primitiveType == "int16")   { itemChanged = setMapItem<int16_t>(value, newKey, decodeInt16(bytes, it)); }
+                        else if (primitiveType == "uint16")  { itemChanged = setMapItem<uint16_t>(value, newKey, decodeUint16(bytes, it)); }
+                        else if (primitiveType == "int32")   { itemChanged = setMapItem<int32_t>(value, newKey, decodeInt32(bytes, it)); }
+                        else if (primitiveType == "uint32")  { itemChanged = setMapItem<uint32_t>(value, newKey, decodeUint32(bytes, it)); }
+                        else if (primitiveType == "int64")   { itemChanged = setMapItem<int64_t>(value, newKey, decodeInt64(bytes, it)); }
+                        else if (primitiveType == "uint64")  { itemChanged = setMapItem<uint64_t>(value, newKey, decodeUint64(bytes, it)); }
+                        else if (primitiveType == "float32") { itemChanged = setMapItem<float32_t>(value, newKey, decodeFloat32(bytes, it)); }
+                        else if (primitiveType == "float64") { itemChanged = setMapItem<float64_t>(value, newKey, decodeFloat64(bytes, it)); }
                         else { throw std::invalid_argument("cannot decode invalid type: " + primitiveType); }
 
 
                     }
                     else
                     {
-                        ((Schema*) item)->decode(bytes, totalBytes, it);
+                        bool wasReconciling = it->reconcile;
+                        if (isNew) { it->reconcile = false; }
+                        itemChanged = ((Schema*) item)->decode(bytes, totalBytes, it) || isNew;
+                        it->reconcile = wasReconciling;
+
                         value->insert(newKey, item);
                     }
 
-                    if (isNew)
+                    if (it->reconcile) { decodedKeys.insert(newKey); }
+                    anyItemChanged = anyItemChanged || itemChanged;
+
+                    if (isSchemaType)
                     {
-                        if (valueRef->onAdd)
+                        if (isNew)
                         {
-                            valueRef->onAdd(item, newKey);
+                            if (valueRef->onAdd)
+                            {
+                                valueRef->onAdd(item, newKey);
+                            }
                         }
+                        else if (valueRef->onChange && (!it->reconcile || itemChanged))
+                        {
+                            valueRef->onChange(item, newKey);
+                        }
+                        continue;
                     }
-                    else if (valueRef->onChange)
-                    {
-                        valueRef->onChange(item, newKey);
-                    }
+
+                    visitMap(primitiveType, valueRef, [&](auto *typed) {
+                        if (isNew)
+                        {
+                            if (typed->onAdd)
+                            {
+                                typed->onAdd(typed->items.at(newKey), newKey);
+                            }
+                        }
+                        else if (typed->onChange && (!it->reconcile || itemChanged))
+                        {
+                            typed->onChange(typed->items.at(newKey), newKey);
+                        }
+                    });
+                }
+
+                // A full state lists every item, so anything it left out is gone.
+                if (it->reconcile)
+                {
+                    visitMap(primitiveType, valueRef, [&](auto *typed) {
+                        for (const string &previousKey : previousKeys)
+                        {
+                            if (decodedKeys.find(previousKey) != decodedKeys.end() || !typed->has(previousKey))
+                            {
+                                continue;
+                            }
+
+                            auto removed = typed->items.at(previousKey);
+                            notifyItemRemoved(removed);
+                            if (typed->onRemove)
+                            {
+                                typed->onRemove(removed, previousKey);
+                            }
+
+                            typed->items.erase(previousKey);
+                            anyItemChanged = true;
+                        }
+                    });
+
+                    hasChange = anyItemChanged;
                 }
 
                 this->setMap(field, value);
 
             }
+            else if (it->reconcile)
+            {
+                std::vector<unsigned char> previous, current;
+                this->encodePrimitiveType(field, type, previous);
+                this->decodePrimitiveType(field, type, bytes, it);
+                this->encodePrimitiveType(field, type, current);
+                hasChange = previous != current;
+            }
             else
             {
                 this->decodePrimitiveType(field, type, bytes, it);
@@ -711,6 +920,8 @@ class Schema
             std::cout << "stepped out (child type decoding)" << std::endl;
 #endif
 
+            anyChange = anyChange || hasChange;
+
             if (hasChange && this->onChange)
             {
                 DataChange dataChange = DataChange();
@@ -724,8 +935,50 @@ class Schema
         std::cout << "stepped out (structure)." << std::endl;
 #endif
 
+        // A full state leaves out unset fields, so those still holding a value were unset meanwhile.
+        if (it->reconcile && !it->overflow)
+        {
+            for (const auto &indexed : this->_indexes)
+            {
+                if (decodedFields.test(indexed.first))
+                {
+                    continue;
+                }
+
+                const string &field = indexed.second;
+                const string &type = this->_types.at(indexed.first);
+                bool hasChange = false;
+                if (type == "ref")
+                {
+                    Schema* value = this->getRef(field);
+                    if (value != nullptr)
+                    {
+                        if (value->onRemove) { value->onRemove(); }
+                        this->setRef(field, nullptr);
+                        hasChange = true;
+                    }
+                }
+                else if (type != "array" && type != "map")
+                {
+                    std::vector<unsigned char> previous, current;
+                    this->encodePrimitiveType(field, type, previous);
+                    this->resetPrimitiveType(field, type);
+                    this->encodePrimitiveType(field, type, current);
+                    hasChange = previous != current;
+                }
+
+                anyChange = anyChange || hasChange;
+                if (hasChange && this->onChange)
+                {
+                    DataChange dataChange = DataChange();
+                    dataChange.field = field;
+                    changes.push_back(dataChange);
+                }
+            }
+        }
+
         // trigger onChange callback.
-        if (this->onChange)
+        if (this->onChange && (!it->reconcile || anyChange))
         {
 #ifdef COLYSEUS_DEBUG
             std::cout << "let's trigger changes!" << std::endl;
@@ -742,9 +995,150 @@ class Schema
 #ifdef COLYSEUS_DEBUG
         std::cout << "end of decode()" << std::endl;
 #endif
+        return anyChange;
+    }
+
+    // Re-encodes the decoded tree as a full state, in the format decode() reads back.
+    // Used for local snapshots; it is not meant to be sent to the server.
+    inline void encode(std::vector<unsigned char> &bytes)
+    {
+        for (auto &kv : this->_indexes)
+        {
+            unsigned char index = kv.first;
+            const string &field = kv.second;
+            const string &type = this->_types.at(index);
+            bool isSchemaType = this->_childSchemaTypes.find(index) != this->_childSchemaTypes.end();
+            string primitiveType = isSchemaType || (type != "array" && type != "map") ? string() : this->_childPrimitiveTypes.at(index);
+
+            if (type == "ref")
+            {
+                Schema *value = this->getRef(field);
+                if (value == nullptr) { continue; }
+
+                bytes.push_back(index);
+                value->encode(bytes);
+            }
+            else if (type == "array")
+            {
+                ArraySchema<char *> *value = this->getArray(field);
+                int length = 0;
+                visitArray(primitiveType, value, [&](auto *typed) { length = typed->size(); });
+
+                bytes.push_back(index);
+                encodeNumber(bytes, length);
+                encodeNumber(bytes, length);
+
+                for (int i = 0; i < length; i++)
+                {
+                    encodeNumber(bytes, i);
+                    size_t valueOffset = bytes.size();
+
+                    if (isSchemaType)
+                    {
+                        encodeChild(bytes, (Schema *)value->items[i]);
+                    }
+                    else
+                    {
+                        this->encodeArrayItem(bytes, primitiveType, value, i);
+                    }
+
+                    // A raw value starting with INDEX_CHANGE would be misread by decode(),
+                    // so mark it as an explicit "new item" first.
+                    if (bytes.size() > valueOffset && bytes[valueOffset] == (unsigned char)SPEC::INDEX_CHANGE)
+                    {
+                        const unsigned char marker[2] = {(unsigned char)SPEC::INDEX_CHANGE, 0xff};
+                        bytes.insert(bytes.begin() + valueOffset, marker, marker + 2);
+                    }
+                }
+            }
+            else if (type == "map")
+            {
+                MapSchema<char *> *value = this->getMap(field);
+
+                int length = 0;
+                visitMap(primitiveType, value, [&](auto *typed) { length = typed->size(); });
+
+                bytes.push_back(index);
+                encodeNumber(bytes, length);
+
+                if (isSchemaType)
+                {
+                    for (auto &item : value->items)
+                    {
+                        encodeString(bytes, item.first);
+                        encodeChild(bytes, (Schema *)item.second);
+                    }
+                }
+                else
+                {
+                    this->encodeMapItems(bytes, primitiveType, value);
+                }
+            }
+            else
+            {
+                bytes.push_back(index);
+                this->encodePrimitiveType(field, type, bytes);
+            }
+        }
+
+        bytes.push_back((unsigned char)SPEC::END_OF_STRUCTURE);
+    }
+
+    // 32-bit FNV-1a over the field indexes, names and types of this structure and every child schema
+    // type, so encoded data can be matched with the layout it was written for.
+    inline uint32_t layoutHash()
+    {
+        uint32_t hash = 2166136261u;
+        std::set<std::type_index> visited;
+        hashLayout(hash, visited);
+        return hash;
     }
 
   protected:
+    inline void hashLayout(uint32_t &hash, std::set<std::type_index> &visited)
+    {
+        visited.insert(std::type_index(typeid(*this)));
+
+        auto mix = [&hash](const string &value) {
+            for (unsigned char c : value) { hash = (hash ^ c) * 16777619u; }
+            // Terminator, so adjacent strings cannot run into each other
+            hash = (hash ^ 0xffu) * 16777619u;
+        };
+
+        for (const auto &indexed : this->_indexes)
+        {
+            hash = (hash ^ indexed.first) * 16777619u;
+            mix(indexed.second);
+            mix(this->_types.at(indexed.first));
+
+            auto primitiveType = this->_childPrimitiveTypes.find(indexed.first);
+            if (primitiveType != this->_childPrimitiveTypes.end())
+            {
+                mix(primitiveType->second);
+            }
+
+            auto childType = this->_childSchemaTypes.find(indexed.first);
+            if (childType == this->_childSchemaTypes.end())
+            {
+                continue;
+            }
+
+            // Recursive types are hashed once.
+            if (visited.find(childType->second) != visited.end())
+            {
+                mix("<seen>");
+                continue;
+            }
+
+            Schema *child = this->createInstance(childType->second);
+            if (child != nullptr)
+            {
+                child->hashLayout(hash, visited);
+                delete child;
+            }
+        }
+    }
+
     std::map<unsigned char, string> _indexes;
     std::map<unsigned char, string> _types;
     std::map<unsigned char, string> _childPrimitiveTypes;
@@ -806,6 +1200,181 @@ class Schema
         else if (type == "float64") { this->setFloat64(field, decodeFloat64(bytes, it)); }
         else { throw std::invalid_argument("cannot decode invalid type: " + type); }
     }
+
+    inline void resetPrimitiveType(const string &field, const string &type)
+    {
+        if (type == "string")       { this->setString(field, string()); }
+        else if (type == "number")  { this->setNumber(field, 0); }
+        else if (type == "boolean") { this->setBoolean(field, false); }
+        else if (type == "int8")    { this->setInt8(field, 0); }
+        else if (type == "uint8")   { this->setUint8(field, 0); }
+        else if (type == "int16")   { this->setInt16(field, 0); }
+        else if (type == "uint16")  { this->setUint16(field, 0); }
+        else if (type == "int32")   { this->setInt32(field, 0); }
+        else if (type == "uint32")  { this->setUint32(field, 0); }
+        else if (type == "int64")   { this->setInt64(field, 0); }
+        else if (type == "uint64")  { this->setUint64(field, 0); }
+        else if (type == "float32") { this->setFloat32(field, 0); }
+        else if (type == "float64") { this->setFloat64(field, 0); }
+        else { throw std::invalid_argument("cannot reset invalid type: " + type); }
+    }
+
+    // Schema items of a collection hear about their own removal; primitive items have no callback.
+    static inline void notifyItemRemoved(char *item)
+    {
+        if (item != nullptr && ((Schema *)item)->onRemove)
+        {
+            ((Schema *)item)->onRemove();
+        }
+    }
+
+    template <typename T>
+    static inline void notifyItemRemoved(const T &) {}
+
+    // Call visit with the collection cast to its real type: schema children are held as char *,
+    // primitives by value.
+    template <typename Visitor>
+    static inline void visitArray(const string &primitiveType, ArraySchema<char *> *array, Visitor visit)
+    {
+        if (primitiveType.empty())           { visit(array); }
+        else if (primitiveType == "string")  { visit((ArraySchema<string> *)array); }
+        else if (primitiveType == "number")  { visit((ArraySchema<varint_t> *)array); }
+        else if (primitiveType == "boolean") { visit((ArraySchema<bool> *)array); }
+        else if (primitiveType == "int8")    { visit((ArraySchema<int8_t> *)array); }
+        else if (primitiveType == "uint8")   { visit((ArraySchema<uint8_t> *)array); }
+        else if (primitiveType == "int16")   { visit((ArraySchema<int16_t> *)array); }
+        else if (primitiveType == "uint16")  { visit((ArraySchema<uint16_t> *)array); }
+        else if (primitiveType == "int32")   { visit((ArraySchema<int32_t> *)array); }
+        else if (primitiveType == "uint32")  { visit((ArraySchema<uint32_t> *)array); }
+        else if (primitiveType == "int64")   { visit((ArraySchema<int64_t> *)array); }
+        else if (primitiveType == "uint64")  { visit((ArraySchema<uint64_t> *)array); }
+        else if (primitiveType == "float32") { visit((ArraySchema<float32_t> *)array); }
+        else if (primitiveType == "float64") { visit((ArraySchema<float64_t> *)array); }
+        else { throw std::invalid_argument("cannot decode invalid type: " + primitiveType); }
+    }
+
+    template <typename Visitor>
+    static inline void visitMap(const string &primitiveType, MapSchema<char *> *map, Visitor visit)
+    {
+        if (primitiveType.empty())           { visit(map); }
+        else if (primitiveType == "string")  { visit((MapSchema<string> *)map); }
+        else if (primitiveType == "number")  { visit((MapSchema<varint_t> *)map); }
+        else if (primitiveType == "boolean") { visit((MapSchema<bool> *)map); }
+        else if (primitiveType == "int8")    { visit((MapSchema<int8_t> *)map); }
+        else if (primitiveType == "uint8")   { visit((MapSchema<uint8_t> *)map); }
+        else if (primitiveType == "int16")   { visit((MapSchema<int16_t> *)map); }
+        else if (primitiveType == "uint16")  { visit((MapSchema<uint16_t> *)map); }
+        else if (primitiveType == "int32")   { visit((MapSchema<int32_t> *)map); }
+        else if (primitiveType == "uint32")  { visit((MapSchema<uint32_t> *)map); }
+        else if (primitiveType == "int64")   { visit((MapSchema<int64_t> *)map); }
+        else if (primitiveType == "uint64")  { visit((MapSchema<uint64_t> *)map); }
+        else if (primitiveType == "float32") { visit((MapSchema<float32_t> *)map); }
+        else if (primitiveType == "float64") { visit((MapSchema<float64_t> *)map); }
+        else { throw std::invalid_argument("cannot decode invalid type: " + primitiveType); }
+    }
+
+    // Store a primitive collection item, reporting whether it is new or differs from the stored value.
+    template <typename T>
+    static inline bool setArrayItem(ArraySchema<char *> *array, int index, const T &newValue)
+    {
+        ArraySchema<T> *typed = (ArraySchema<T> *)array;
+        bool changed = !typed->has(index) || !(typed->items[index] == newValue);
+        typed->setAt(index, newValue);
+        return changed;
+    }
+
+    template <typename T>
+    static inline bool setMapItem(MapSchema<char *> *map, const string &key, const T &newValue)
+    {
+        MapSchema<T> *typed = (MapSchema<T> *)map;
+        bool changed = !typed->has(key) || !(typed->items[key] == newValue);
+        typed->items[key] = newValue;
+        return changed;
+    }
+
+    static inline void encodeChild(std::vector<unsigned char> &bytes, Schema *child)
+    {
+        if (child != nullptr) { child->encode(bytes); }
+        else { bytes.push_back((unsigned char)SPEC::END_OF_STRUCTURE); }
+    }
+
+    static inline void encodeBoolean(std::vector<unsigned char> &bytes, bool value) { encodeRaw<uint8_t>(bytes, value ? 1 : 0); }
+    static inline void encodeVarint(std::vector<unsigned char> &bytes, varint_t value) { encodeNumber(bytes, value); }
+    static inline void encodeStdString(std::vector<unsigned char> &bytes, string value) { encodeString(bytes, value); }
+
+    inline void encodePrimitiveType(const string &field, const string &type, std::vector<unsigned char> &bytes)
+    {
+        if (type == "string")       { encodeString(bytes, this->getString(field)); }
+        else if (type == "number")  { encodeNumber(bytes, this->getNumber(field)); }
+        else if (type == "boolean") { encodeBoolean(bytes, this->getBoolean(field)); }
+        else if (type == "int8")    { encodeRaw<int8_t>(bytes, this->getInt8(field)); }
+        else if (type == "uint8")   { encodeRaw<uint8_t>(bytes, this->getUint8(field)); }
+        else if (type == "int16")   { encodeRaw<int16_t>(bytes, this->getInt16(field)); }
+        else if (type == "uint16")  { encodeRaw<uint16_t>(bytes, this->getUint16(field)); }
+        else if (type == "int32")   { encodeRaw<int32_t>(bytes, this->getInt32(field)); }
+        else if (type == "uint32")  { encodeRaw<uint32_t>(bytes, this->getUint32(field)); }
+        else if (type == "int64")   { encodeRaw<int64_t>(bytes, this->getInt64(field)); }
+        else if (type == "uint64")  { encodeRaw<uint64_t>(bytes, this->getUint64(field)); }
+        else if (type == "float32") { encodeRaw<float32_t>(bytes, this->getFloat32(field)); }
+        else if (type == "float64") { encodeRaw<float64_t>(bytes, this->getFloat64(field)); }
+        else { throw std::invalid_argument("cannot encode invalid type: " + type); }
+    }
+
+    template <typename T>
+    static inline void encodeArrayItemAs(std::vector<unsigned char> &bytes, ArraySchema<char *> *array, int index,
+                                         void (*encoder)(std::vector<unsigned char> &bytes, T value))
+    {
+        encoder(bytes, ((ArraySchema<T> *)array)->items[index]);
+    }
+
+    inline void encodeArrayItem(std::vector<unsigned char> &bytes, const string &type, ArraySchema<char *> *array, int index)
+    {
+        // Same types, in the same order, as the primitive array branch of decode()
+        if (type == "string")       { encodeArrayItemAs<string>(bytes, array, index, &encodeStdString); }
+        else if (type == "number")  { encodeArrayItemAs<varint_t>(bytes, array, index, &encodeVarint); }
+        else if (type == "boolean") { encodeArrayItemAs<bool>(bytes, array, index, &encodeBoolean); }
+        else if (type == "int8")    { encodeArrayItemAs<int8_t>(bytes, array, index, &encodeRaw<int8_t>); }
+        else if (type == "uint8")   { encodeArrayItemAs<uint8_t>(bytes, array, index, &encodeRaw<uint8_t>); }
+        else if (type == "int16")   { encodeArrayItemAs<int16_t>(bytes, array, index, &encodeRaw<int16_t>); }
+        else if (type == "uint16")  { encodeArrayItemAs<uint16_t>(bytes, array, index, &encodeRaw<uint16_t>); }
+        else if (type == "int32")   { encodeArrayItemAs<int32_t>(bytes, array, index, &encodeRaw<int32_t>); }
+        else if (type == "uint32")  { encodeArrayItemAs<uint32_t>(bytes, array, index, &encodeRaw<uint32_t>); }
+        else if (type == "int64")   { encodeArrayItemAs<int64_t>(bytes, array, index, &encodeRaw<int64_t>); }
+        else if (type == "uint64")  { encodeArrayItemAs<uint64_t>(bytes, array, index, &encodeRaw<uint64_t>); }
+        else if (type == "float32") { encodeArrayItemAs<float32_t>(bytes, array, index, &encodeRaw<float32_t>); }
+        else if (type == "float64") { encodeArrayItemAs<float64_t>(bytes, array, index, &encodeRaw<float64_t>); }
+        else { throw std::invalid_argument("cannot encode invalid type: " + type); }
+    }
+
+    template <typename T>
+    static inline void encodeMapItemsAs(std::vector<unsigned char> &bytes, MapSchema<char *> *map,
+                                        void (*encoder)(std::vector<unsigned char> &bytes, T value))
+    {
+        for (auto &item : ((MapSchema<T> *)map)->items)
+        {
+            encodeString(bytes, item.first);
+            encoder(bytes, item.second);
+        }
+    }
+
+    inline void encodeMapItems(std::vector<unsigned char> &bytes, const string &type, MapSchema<char *> *map)
+    {
+        // Same types, in the same order, as the primitive map branch of decode()
+        if (type == "string")       { encodeMapItemsAs<string>(bytes, map, &encodeStdString); }
+        else if (type == "number")  { encodeMapItemsAs<varint_t>(bytes, map, &encodeVarint); }
+        else if (type == "boolean") { encodeMapItemsAs<bool>(bytes, map, &encodeBoolean); }
+        else if (type == "int8")    { encodeMapItemsAs<int8_t>(bytes, map, &encodeRaw<int8_t>); }
+        else if (type == "uint8")   { encodeMapItemsAs<uint8_t>(bytes, map, &encodeRaw<uint8_t>); }
+        else if (type == "int16")   { encodeMapItemsAs<int16_t>(bytes, map, &encodeRaw<int16_t>); }
+        else if (type == "uint16")  { encodeMapItemsAs<uint16_t>(bytes, map, &encodeRaw<uint16_t>); }
+        else if (type == "int32")   { encodeMapItemsAs<int32_t>(bytes, map, &encodeRaw<int32_t>); }
+        else if (type == "uint32")  { encodeMapItemsAs<uint32_t>(bytes, map, &encodeRaw<uint32_t>); }
+        else if (type == "int64")   { encodeMapItemsAs<int64_t>(bytes, map, &encodeRaw<int64_t>); }
+        else if (type == "uint64")  { encodeMapItemsAs<uint64_t>(bytes, map, &encodeRaw<uint64_t>); }
+        else if (type == "float32") { encodeMapItemsAs<float32_t>(bytes, map, &encodeRaw<float32_t>); }
+        else if (type == "float64") { encodeMapItemsAs<float64_t>(bytes, map, &encodeRaw<float64_t>); }
+        else { throw std::invalid_argument("cannot encode invalid type: " + type); }
+    }
 };
 
 } // namespace schema
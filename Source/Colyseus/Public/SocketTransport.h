@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Transport.h"
+
+#include <Async/Future.h>
+#include <HAL/CriticalSection.h>
+#include <HAL/Event.h>
+#include <HAL/Runnable.h>
+
+#include <atomic>
+
+class FSocket;
+class FRunnableThread;
+
+/**
+ * Minimal WebSocket client over a plain engine socket, for headless builds and bots that should
+ * not depend on the WebSockets module. Only ws:// is supported (no TLS, no extensions).
+ *
+ * Receiving happens on a thread of its own, so callbacks fire off the game thread; Connection
+ * queues them automatically (see RequiresEventQueue()). Sending only queues the frame: a writer
+ * thread puts it on the wire, so a slow link never blocks the caller or the reader, and the bytes
+ * still waiting are reported by GetBufferedAmount().
+ */
+class COLYSEUSCLIENT_API SocketTransport : public ITransport, public FRunnable
+{
+public:
+	~SocketTransport();
+
+	// Methods
+	void Connect(const FString& Url) override;
+	void Send(const void* Data, SIZE_T Size) override;
+	void Close(int32 Code, const FString& Reason) override;
+	int64 GetBufferedAmount() const override;
+	void Detach() override;
+
+	bool RequiresEventQueue() const override
+	{
+		return true;
+	}
+
+	// FRunnable
+	uint32 Run() override;
+	void Stop() override;
+
+	// Properties
+
+	// Frames larger than this are treated as a protocol error
+	uint64 MaxFrameSize = 64 * 1024 * 1024;
+	// Same for messages reassembled from fragments
+	uint64 MaxMessageSize = 64 * 1024 * 1024;
+
+private:
+	bool ParseUrl(const FString& Url);
+	bool OpenSocket();
+	bool Handshake();
+	bool ReadFrames();
+	bool ReadExact(uint8* Out, int64 Size);
+	bool WriteAll(const uint8* Data, int64 Size);
+	void SendFrame(uint8 Opcode, const void* Data, SIZE_T Size);
+	void WriteFrames();
+	void StopWriter();
+	void Fail(const FString& Error);
+
+	FString Host;
+	int32 Port = 80;
+	FString Resource;
+
+	// Set by the transport thread under SocketLock, which Stop() takes to shut it down
+	FSocket* Socket = nullptr;
+	FCriticalSection SocketLock;
+	FRunnableThread* Thread = nullptr;
+	FCriticalSection SendLock;
+
+	// Writer thread, started once the handshake is done; WriteEvent wakes it when frames are queued
+	TFuture<void> Writer;
+	FEvent* WriteEvent = nullptr;
+	std::atomic<bool> bWriterStopping{false};
+	std::atomic<int64> BufferedBytes{0};
+
+	std::atomic<bool> bStopping{false};
+	std::atomic<bool> bOpen{false};
+	// Set once a close frame is queued or a write fails, after which nothing is sent; guarded by SendLock
+	bool bCloseSent = false;
+
+	// Buffered reads, so small frame headers do not cost one syscall each
+	TArray<uint8> ReadBuffer;
+	int32 ReadOffset = 0;
+	int32 ReadEnd = 0;
+
+	// Payload of a fragmented message still waiting for its final frame
+	TArray<uint8> MessageBuffer;
+	bool bFragmented = false;
+	TArray<uint8> FrameBuffer;
+
+	// Encoded frames waiting for the writer thread; guarded by SendLock
+	TArray<uint8> SendBuffer;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <CoreMinimal.h>
+
+/**
+ * The byte pipe underneath a Connection. Implementations report received data through the
+ * callbacks below, which Connection sets before calling Connect().
+ */
+class COLYSEUSCLIENT_API ITransport
+{
+public:
+	virtual ~ITransport() = default;
+
+	// Methods
+	virtual void Connect(const FString& Url) = 0;
+	virtual void Send(const void* Data, SIZE_T Size) = 0;
+	virtual void Close(int32 Code, const FString& Reason) = 0;
+
+	/** Bytes accepted by Send() that have not reached the wire yet, where the transport can tell. */
+	virtual int64 GetBufferedAmount() const
+	{
+		return 0;
+	}
+
+	/** Closes the transport and guarantees no callback runs afterwards; used when the owner goes away. */
+	virtual void Detach()
+	{
+		OnConnected = nullptr;
+		OnConnectionError = nullptr;
+		OnRawMessage = nullptr;
+		OnClosed = nullptr;
+		Close(1000, FString());
+	}
+
+	/** True if callbacks fire on a thread of the transport's own, so Connection must queue them. */
+	virtual bool RequiresEventQueue() const
+	{
+		return false;
+	}
+
+	// Callbacks
+	TFunction<void()> OnConnected;
+	TFunction<void(const FString& Error)> OnConnectionError;
+	TFunction<void(const void* Data, SIZE_T Size, SIZE_T BytesRemaining)> OnRawMessage;
+	TFunction<void(int32 StatusCode, const FString& Reason, bool bWasClean)> OnClosed;
+};
+
+typedef TFunction<TSharedPtr<ITransport>()> TransportFactory;
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Transport.h"
+
+#include <IWebSocket.h>
+
+/** Transport backed by the engine's WebSockets module; the default for Connection. */
+class COLYSEUSCLIENT_API WebSocketTransport : public ITransport
+{
+public:
+	~WebSocketTransport();
+
+	// Methods
+	void Connect(const FString& Url) override;
+	void Send(const void* Data, SIZE_T Size) override;
+	void Close(int32 Code, const FString& Reason) override;
+
+	/** Loads the WebSockets module if needed. Must run on the game thread. */
+	static void EnsureModuleLoaded();
+
+private:
+	TSharedPtr<IWebSocket> Socket;
+};